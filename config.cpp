@@ -27,6 +27,7 @@
 #include <cerrno>
 #include <cstring>
 #include <cstdio>
+#include <cstdlib>
 #include <stdexcept>
 #include <sstream>
 #include <iostream>
@@ -36,6 +37,10 @@ static const char * CONFIG_FILE_NAME = "yip.conf";
 
 static const char * SECTION_GLOBAL = "global";
 static const char * OPTION_PROJECT_FILE_NAME = "project_file_name";
+static const char * OPTION_JOBS = "jobs";
+static const char * OPTION_CHANGE_DETECTION = "change_detection";
+static const char * OPTION_GC_AGE = "gc_age";
+static const char * OPTION_OUTPUT_CACHE_DIR = "output_cache_dir";
 
 static const char * SECTION_REPOSITORIES = "repo";
 
@@ -46,7 +51,10 @@ ConfigPtr g_Config;
 /* Config */
 
 Config::Config()
-	: projectFileName(PROJECT_FILE_NAME)
+	: projectFileName(PROJECT_FILE_NAME),
+	  jobs(0),
+	  changeDetection(CHANGE_DETECTION_MTIME),
+	  gcAge(30)
 {
 	repos.insert(std::make_pair("amazon-aws-runtime", "https://github.com/bin-forks/amazon-aws-runtime.git"));
 	repos.insert(std::make_pair("amazon-aws-s3", "https://github.com/bin-forks/amazon-aws-s3.git"));
@@ -142,6 +150,48 @@ static int iniHandler(void * user, const char * section, const char * name, cons
 				context->config->projectFileName = value;
 				return Ok;
 			}
+			else if (!strcmp(name, OPTION_JOBS))
+			{
+				char * end = nullptr;
+				unsigned long jobs = strtoul(value, &end, 10);
+				if (!*value || *end)
+				{
+					context->errorMsg = fmt() << "invalid value for parameter '" << section << '/' << name << "'.";
+					return Error;
+				}
+				context->config->jobs = static_cast<unsigned>(jobs);
+				return Ok;
+			}
+			else if (!strcmp(name, OPTION_CHANGE_DETECTION))
+			{
+				if (!strcmp(value, "mtime"))
+					context->config->changeDetection = CHANGE_DETECTION_MTIME;
+				else if (!strcmp(value, "content"))
+					context->config->changeDetection = CHANGE_DETECTION_CONTENT;
+				else
+				{
+					context->errorMsg = fmt() << "invalid value for parameter '" << section << '/' << name << "'.";
+					return Error;
+				}
+				return Ok;
+			}
+			else if (!strcmp(name, OPTION_GC_AGE))
+			{
+				char * end = nullptr;
+				unsigned long days = strtoul(value, &end, 10);
+				if (!*value || *end)
+				{
+					context->errorMsg = fmt() << "invalid value for parameter '" << section << '/' << name << "'.";
+					return Error;
+				}
+				context->config->gcAge = static_cast<unsigned>(days);
+				return Ok;
+			}
+			else if (!strcmp(name, OPTION_OUTPUT_CACHE_DIR))
+			{
+				context->config->outputCacheDir = value;
+				return Ok;
+			}
 		}
 		else if (!strcmp(section, SECTION_REPOSITORIES))
 		{
@@ -209,6 +259,11 @@ void Config::write(const std::string & path)
 	ss << '\n';
 	ss << "[" << SECTION_GLOBAL << "]\n";
 	ss << OPTION_PROJECT_FILE_NAME << " = " << projectFileName << '\n';
+	ss << OPTION_JOBS << " = " << jobs << '\n';
+	ss << OPTION_CHANGE_DETECTION << " = "
+		<< (changeDetection == CHANGE_DETECTION_CONTENT ? "content" : "mtime") << '\n';
+	ss << OPTION_GC_AGE << " = " << gcAge << '\n';
+	ss << OPTION_OUTPUT_CACHE_DIR << " = " << outputCacheDir << '\n';
 	ss << '\n';
 
 	ss << "[" << SECTION_REPOSITORIES << "]\n";
@@ -268,6 +323,10 @@ ConfigPtr loadConfigFile(bool create)
 			<< pathToNativeSeparators(configFile) << "': " << strerror(err) << std::endl;
 	}
 
+	// Relative path to the cache is relative to the configuration directory
+	if (!config->outputCacheDir.empty())
+		config->outputCacheDir = pathMakeAbsolute(config->outputCacheDir, configPath);
+
 	return config;
 }
 
@@ -27,10 +27,20 @@
 #include <memory>
 #include <map>
 
+enum ChangeDetection
+{
+	CHANGE_DETECTION_MTIME = 0,		// Compare modification times of input and output files
+	CHANGE_DETECTION_CONTENT,		// Compare hashes of the input files
+};
+
 struct Config
 {
 	std::string projectFileName;
 	std::map<std::string, std::string> repos;
+	unsigned jobs;	// Number of worker threads (0 = number of CPUs)
+	ChangeDetection changeDetection;
+	unsigned gcAge;	// Generated files not used for this number of days are deleted (0 = never)
+	std::string outputCacheDir;	// Directory of the cache shared between projects (empty = no cache)
 
 	Config();
 
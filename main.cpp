@@ -21,6 +21,7 @@
 // THE SOFTWARE.
 //
 #include "project/project_file_parser.h"
+#include "project/project_snapshot.h"
 #include "project/generate_xcode.h"
 #include "project/generate_android.h"
 #include "project/generate_tizen.h"
@@ -30,6 +31,7 @@
 #include "xcode/xcode_unique_id.h"
 #include "util/cxx-util/cxx-util/fmt.h"
 #include "util/shell.h"
+#include "util/file_cache.h"
 #include "util/path-util/path-util.h"
 #include "config.h"
 #include <exception>
@@ -93,6 +95,10 @@ static void usage()
 	    "     behavior, add the following option to the command-line:\n"              /*|*/
 	    "       -b, --build-only    Do not call `adb install` when building for Android.\n"
 	    "\n"                                                                          /*|*/
+	    "     To find out why generated files were rewritten, add the following option\n"
+	    "     to the command-line:\n"                                                 /*|*/
+	    "           --explain       Print why each generated file was written or kept.\n"
+	    "\n"                                                                          /*|*/
 	    " * generate (gen): Generate project file but do not build.\n"                /*|*/
 	    "\n"                                                                          /*|*/
 	    "     By default, yip generates project file for the current platform only.\n"/*|*/
@@ -114,11 +120,24 @@ static void usage()
 	    "     add the following option to the command-line:\n"                        /*|*/
 	    "       -u, --update        Update imports.\n"                                /*|*/
 	    "\n"                                                                          /*|*/
+	    "     To find out why generated files were rewritten, add the following option\n"
+	    "     to the command-line:\n"                                                 /*|*/
+	    "           --explain       Print why each generated file was written or kept.\n"
+	    "\n"                                                                          /*|*/
 	    "     All generated project files are stored into the .yip subdirectory in your\n"
 	    "     source directory.\n"                                                    /*|*/
 	    "\n"                                                                          /*|*/
 	    " * update (up): Download latest versions of imports.\n"                      /*|*/
 	    "\n"                                                                          /*|*/
+	    " * gc: Delete generated files that were not used recently and compact the\n" /*|*/
+	    "     database in the .yip subdirectory. Unused files are also deleted from the\n"
+	    "     output cache, if it is enabled.\n"                                      /*|*/
+	    "\n"                                                                          /*|*/
+	    "     By default, files not used for the number of days set by the gc_age\n"  /*|*/
+	    "     configuration option are deleted. This can be overriden by the\n"       /*|*/
+	    "     following option:\n"                                                    /*|*/
+	    "       -d, --days N        Delete files not used for N days.\n"              /*|*/
+	    "\n"                                                                          /*|*/
 	    " * help: Display this help message.\n"                                       /*|*/
 	    << std::endl;
 }
@@ -133,6 +152,15 @@ static ProjectPtr loadProject(Platform::Type platform = Platform::None)
 	XCodeUniqueID::setSeed(projectPath);
 
 	ProjectPtr project = std::make_shared<Project>(projectPath);
+
+	// Utility repositories imported below depend on the requested platforms and on the previous builds
+	std::string snapshotSettings = fmt()
+		<< "ios=" << (ios || project->yipDirectory()->didBuildIOS())
+		<< " android=" << (android || project->yipDirectory()->didBuildAndroid())
+		<< " tizen=" << (tizen || project->yipDirectory()->didBuildTizen());
+	if (ProjectSnapshot::load(project, snapshotSettings))
+		return project;
+
 	ProjectFileParser::parseFromCurrentDirectory(project, true);
 
 	if ((ios || project->yipDirectory()->didBuildIOS()) && project->shouldImportIOSUtil())
@@ -167,9 +195,28 @@ static ProjectPtr loadProject(Platform::Type platform = Platform::None)
 		project->addHeaderPath(headerPath, Platform::Tizen);
 	}
 
+	ProjectSnapshot::save(project, snapshotSettings);
+
 	return project;
 }
 
+static void printGarbageStats(const YipDirectory::GarbageStats & stats)
+{
+	std::cout << "removed " << stats.numFiles << " unused file(s), " << stats.bytesFreed << " byte(s) reclaimed."
+		<< std::endl;
+}
+
+// Deletes generated files that were not used for a long time. Called at the end of the run.
+static void sweepYipDirectory(const ProjectPtr & project)
+{
+	if (g_Config->gcAge == 0)
+		return;
+
+	YipDirectory::GarbageStats stats = project->yipDirectory()->collectGarbage(g_Config->gcAge, false);
+	if (stats.numFiles > 0)
+		printGarbageStats(stats);
+}
+
 static void updateProjectImports(const ProjectPtr & project)
 {
 	if (project->imports().size() == 0)
@@ -274,7 +321,7 @@ static bool runAndroidBuild(const std::string & projectName, const std::string &
 
 static int build(int argc, char ** argv)
 {
-	bool update = false, buildIOS = false, buildIOSSimulator = false, install = true;
+	bool update = false, buildIOS = false, buildIOSSimulator = false, install = true, explain = false;
 	BuildType::Value buildType = BuildType::Unspecified;
 	Platform::Type platform = Platform::None;
 
@@ -306,6 +353,8 @@ static int build(int argc, char ** argv)
 			platform |= Platform::Tizen;
 		else if (!strcmp(argv[i], "-a") || !strcmp(argv[i], "--android"))
 			platform |= Platform::Android;
+		else if (!strcmp(argv[i], "--explain"))
+			explain = true;
 	}
 
 	if (buildType == BuildType::Unspecified)
@@ -329,6 +378,7 @@ static int build(int argc, char ** argv)
 	ProjectPtr project = loadProject(platform);
 	if (!project->isValid())
 		return 1;
+	project->yipDirectory()->setExplain(explain);
 
 	project->generateLicenseData();
 	compileUI(project);
@@ -339,6 +389,7 @@ static int build(int argc, char ** argv)
 	if (platform & Platform::OSX)
 	{
 		std::string projectPath = generateXCode(project, false);
+		project->yipDirectory()->flush();
 	  #ifdef __APPLE__
 		if (runXCodeBuild(projectPath, buildType, std::string()))
 			platform &= ~Platform::OSX;
@@ -350,6 +401,7 @@ static int build(int argc, char ** argv)
 	if (platform & Platform::iOS)
 	{
 		std::string projectPath = generateXCode(project, true);
+		project->yipDirectory()->flush();
 	  #ifdef __APPLE__
 		bool ok1 = (!buildIOS || runXCodeBuild(projectPath, buildType, "iphoneos"));
 		bool ok2 = (!buildIOSSimulator || runXCodeBuild(projectPath, buildType, "iphonesimulator"));
@@ -371,10 +423,16 @@ static int build(int argc, char ** argv)
 	if (platform & Platform::Android)
 	{
 		std::string projectPath = generateAndroid(project);
+		project->yipDirectory()->flush();
 		if (runAndroidBuild(project->projectName(), pathGetDirectory(projectPath), buildType, install))
 			platform &= ~Platform::Android;
 	}
 
+	sweepYipDirectory(project);
+
+	if (explain)
+		project->yipDirectory()->printExplanation();
+
 	if (platform != 0)
 	{
 		std::cerr << "Not all platforms/targets were built (0x" << std::hex << std::setw(4) << std::setfill('0')
@@ -391,7 +449,7 @@ static int build(int argc, char ** argv)
 static int generate(int argc, char ** argv)
 {
 	Platform::Type platform = Platform::None;
-	bool update = false, noOpen = false;
+	bool update = false, noOpen = false, explain = false;
 
 	for (int i = 0; i < argc; i++)
 	{
@@ -409,6 +467,8 @@ static int generate(int argc, char ** argv)
 			platform |= Platform::Android;
 		else if (!strcmp(argv[i], "-n") || !strcmp(argv[i], "--no-open"))
 			noOpen = true;
+		else if (!strcmp(argv[i], "--explain"))
+			explain = true;
 	}
 
 	if (platform == Platform::None)
@@ -430,6 +490,7 @@ static int generate(int argc, char ** argv)
 	ProjectPtr project = loadProject(platform);
 	if (!project->isValid())
 		return 1;
+	project->yipDirectory()->setExplain(explain);
 
 	project->generateLicenseData();
 	compileUI(project);
@@ -487,6 +548,11 @@ static int generate(int argc, char ** argv)
 		platform &= ~Platform::Android;
 	}
 
+	sweepYipDirectory(project);
+
+	if (explain)
+		project->yipDirectory()->printExplanation();
+
 	if (platform != 0)
 	{
 		std::cerr << "Not all platforms were generated (0x" << std::hex << std::setw(4) << std::setfill('0')
@@ -506,6 +572,52 @@ static int update(int, char **)
 	return 0;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Garbage collection
+
+static int gc(int argc, char ** argv)
+{
+	unsigned days = g_Config->gcAge;
+
+	for (int i = 0; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-d") || !strcmp(argv[i], "--days"))
+		{
+			char * end = nullptr;
+			if (i + 1 >= argc || !*argv[i + 1])
+				throw std::runtime_error(fmt() << "missing value for option '" << argv[i] << "'.");
+			days = static_cast<unsigned>(strtoul(argv[i + 1], &end, 10));
+			if (*end || days == 0)
+				throw std::runtime_error(fmt() << "invalid value for option '" << argv[i] << "'.");
+			++i;
+		}
+		else
+			throw std::runtime_error(fmt() << "invalid parameter '" << argv[i] << "'.");
+	}
+
+	// Zero age means that unused files are kept forever
+	if (days == 0)
+	{
+		std::cout << "garbage collection is disabled by the 'gc_age' setting." << std::endl;
+		return 0;
+	}
+
+	// Project file is not parsed, only the .yip directory is needed
+	std::string projectPath = pathGetDirectory(pathMakeAbsolute(g_Config->projectFileName));
+	YipDirectory yipDirectory(projectPath, nullptr);
+	printGarbageStats(yipDirectory.collectGarbage(days, true));
+
+	if (!g_Config->outputCacheDir.empty())
+	{
+		FileCache cache(g_Config->outputCacheDir);
+		FileCache::GarbageStats stats = cache.collectGarbage(days);
+		std::cout << "removed " << stats.numFiles << " file(s) from the output cache, " << stats.bytesFreed
+			<< " byte(s) reclaimed." << std::endl;
+	}
+
+	return 0;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // XCode pre-build helper
 
@@ -580,6 +692,7 @@ int main(int argc, char ** argv)
 		{
 			std::unordered_map<std::string, int (*)(int, char **)> commands;
 			commands.insert(std::make_pair("build", &build));
+			commands.insert(std::make_pair("gc", &gc));
 			commands.insert(std::make_pair("generate", &generate));
 			commands.insert(std::make_pair("gen", &generate));
 			commands.insert(std::make_pair("help", &help));
@@ -24,6 +24,7 @@
 #include "../util/cxx-util/cxx-util/replace.h"
 #include "../util/xml.h"
 #include "../util/path-util/path-util.h"
+#include "../util/stat_cache.h"
 #include <map>
 #include <unordered_set>
 #include <sstream>
@@ -91,6 +92,7 @@ static bool isJNIFileType(FileType type)
 	{
 	case FILE_SOURCE_C:
 	case FILE_SOURCE_CXX:
+	case FILE_SOURCE_ASM:
 		return true;
 	default:
 		return false;
@@ -209,10 +211,11 @@ void Gen::deleteOldIconFiles()
 		std::string name = pathConcat(iconDir, pathConcat(it.first, "ic_launcher.png"));
 		std::string path = pathSimplify(pathConcat(project->yipDirectory()->path(), name));
 
-		if (pathIsExistent(path))
+		if (cachedPathIsExistent(path))
 		{
 			std::cout << "killing " << pathToUnixSeparators(name) << std::endl;
 			pathDeleteFile(path);
+			statCacheInvalidate(path);
 		}
 	}
 }
@@ -65,6 +65,7 @@ static bool isCompilableFileType(FileType type)
 	{
 	case FILE_SOURCE_C:
 	case FILE_SOURCE_CXX:
+	case FILE_SOURCE_ASM:
 		return true;
 	default:
 		return false;
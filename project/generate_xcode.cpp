@@ -156,6 +156,7 @@ static std::string fileTypeForXCode(FileType type)
 	case FILE_SOURCE_CXX_HEADER: return XCODE_FILETYPE_SOURCECODE_CPP_H;
 	case FILE_SOURCE_OBJC: return XCODE_FILETYPE_SOURCECODE_C_OBJC;
 	case FILE_SOURCE_OBJCXX: return XCODE_FILETYPE_SOURCECODE_CPP_OBJCPP;
+	case FILE_SOURCE_ASM: return XCODE_FILETYPE_SOURCECODE_ASM;
 	case FILE_SOURCE_JAVA: return XCODE_FILETYPE_SOURCECODE_JAVA;
 	case FILE_SOURCE_JAVASCRIPT: return XCODE_FILETYPE_TEXT;	// FIXME
 	case FILE_SOURCE_LUA: return XCODE_FILETYPE_TEXT;			// FIXME
@@ -184,6 +185,7 @@ static bool isCompilableFileType(FileType type)
 	case FILE_SOURCE_CXX:
 	case FILE_SOURCE_OBJC:
 	case FILE_SOURCE_OBJCXX:
+	case FILE_SOURCE_ASM:
 		return true;
 	default:
 		return false;
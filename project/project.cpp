@@ -67,19 +67,41 @@ const YipDirectoryPtr & Project::yipDirectory() const
 SourceFilePtr Project::addSourceFile(const std::string & name, const std::string & path)
 {
 	SourceFilePtr file = std::make_shared<SourceFile>(name, path);
-	if (!m_SourceFiles.insert(std::make_pair(name, file)).second)
-		throw std::runtime_error(fmt() << "duplicate source file '" << path << "'.");
+	addSourceFile(file);
 	return file;
 }
 
+void Project::addSourceFile(const SourceFilePtr & file)
+{
+	if (!m_SourceFiles.insert(std::make_pair(file->name(), file)).second)
+		throw std::runtime_error(fmt() << "duplicate source file '" << file->path() << "'.");
+}
+
 SourceFilePtr Project::addResourceFile(const std::string & name, const std::string & path)
 {
 	SourceFilePtr file = std::make_shared<SourceFile>(name, path);
-	if (!m_ResourceFiles.insert(std::make_pair(name, file)).second)
-		throw std::runtime_error(fmt() << "duplicate resource file '" << path << "'.");
+	addResourceFile(file);
 	return file;
 }
 
+void Project::addResourceFile(const SourceFilePtr & file)
+{
+	if (!m_ResourceFiles.insert(std::make_pair(file->name(), file)).second)
+		throw std::runtime_error(fmt() << "duplicate resource file '" << file->path() << "'.");
+}
+
+ResourceOptions & Project::resourceOptions(Platform::Type platform)
+{
+	return m_ResourceOptions[platform];
+}
+
+const ResourceOptions & Project::resourceOptions(Platform::Type platform) const
+{
+	static const ResourceOptions defaultOptions;
+	auto it = m_ResourceOptions.find(platform);
+	return (it != m_ResourceOptions.end() ? it->second : defaultOptions);
+}
+
 DefinePtr Project::addDefine(const std::string & name, Platform::Type platforms, BuildType::Value buildTypes)
 {
 	DefinePtr define = std::make_shared<Define>(name);
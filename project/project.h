@@ -26,6 +26,7 @@
 #include "source_file.h"
 #include "header_path.h"
 #include "define.h"
+#include "resource_options.h"
 #include "yip_directory.h"
 #include "../util/git.h"
 #include "../translation/translation_file.h"
@@ -95,6 +96,7 @@ public:
 		std::string parentClass;
 		SourceFilePtr ipad;
 		SourceFilePtr iphone;
+		std::string projectFile;		// Project file that has declared this view controller
 	};
 
 	struct AndroidView
@@ -115,6 +117,21 @@ public:
 	inline time_t modificationTime() const { return m_ModificationTime; }
 	inline void setModificationTime(time_t time) { m_ModificationTime = time; m_HasModificationTime = true; }
 
+	inline void addProjectFile(const std::string & path) { m_ProjectFiles.insert(path); }
+	inline const std::set<std::string> & projectFiles() const { return m_ProjectFiles; }
+
+	inline void addScannedDirectory(const std::string & path) { m_ScannedDirectories.insert(path); }
+	inline const std::set<std::string> & scannedDirectories() const { return m_ScannedDirectories; }
+
+	inline void addIncludeWrapper(const std::string & name, const std::string & path)
+		{ m_IncludeWrappers[name] = path; }
+	inline const std::map<std::string, std::string> & includeWrappers() const { return m_IncludeWrappers; }
+
+	// Serialized parse results of individual project files: loaded from the snapshot and stored into it
+	inline const std::map<std::string, std::string> & cachedFragments() const { return m_CachedFragments; }
+	inline void addParsedFragments(const std::map<std::string, std::string> & fragments)
+		{ m_ParsedFragments.insert(fragments.begin(), fragments.end()); }
+
 	inline void setProjectName(const std::string & name) { m_ProjectName = name; }
 	inline const std::string & projectName() const { return m_ProjectName; }
 
@@ -122,11 +139,16 @@ public:
 	const YipDirectoryPtr & yipDirectory() const;
 
 	SourceFilePtr addSourceFile(const std::string & name, const std::string & path);
+	void addSourceFile(const SourceFilePtr & file);
 	inline const std::map<std::string, SourceFilePtr> & sourceFiles() const { return m_SourceFiles; }
 
 	SourceFilePtr addResourceFile(const std::string & name, const std::string & path);
+	void addResourceFile(const SourceFilePtr & file);
 	inline const std::map<std::string, SourceFilePtr> & resourceFiles() const { return m_ResourceFiles; }
 
+	ResourceOptions & resourceOptions(Platform::Type platform);
+	const ResourceOptions & resourceOptions(Platform::Type platform) const;
+
 	DefinePtr addDefine(const std::string & name, Platform::Type platforms = Platform::All,
 		BuildType::Value buildTypes = BuildType::All);
 	inline const std::map<std::string, DefinePtr> & defines() const { return m_Defines; }
@@ -145,6 +167,8 @@ public:
 
 	void addTranslationFile(const std::string & language, const std::string & name, const std::string & path);
 	inline const std::map<std::string, TranslationFilePtr> & translationFiles() const { return m_TranslationFiles; }
+	inline void addTranslationProjectFile(const std::string & path) { m_TranslationProjectFiles.insert(path); }
+	inline const std::set<std::string> & translationProjectFiles() const { return m_TranslationProjectFiles; }
 	void saveTranslationFiles() const;
 
 	inline void addToDo(const std::string & file, int line, const std::string & message,
@@ -281,12 +305,19 @@ private:
 	std::string m_ProjectPath;
 	time_t m_ModificationTime;
 	bool m_HasModificationTime;
+	std::set<std::string> m_ProjectFiles;
+	std::set<std::string> m_ScannedDirectories;		// Directories whose contents were added to the project
+	std::map<std::string, std::string> m_IncludeWrappers;	// Files in the .yip directory including public headers
+	std::map<std::string, std::string> m_CachedFragments;
+	std::map<std::string, std::string> m_ParsedFragments;
 	std::vector<ToDo> m_ToDo;
 	std::unordered_map<std::string, SourceFilePtr> m_UILayoutFiles;
 	std::map<std::string, TranslationFilePtr> m_TranslationFiles;
+	std::set<std::string> m_TranslationProjectFiles;	// Project files that have declared translation files
 	std::map<std::string, HeaderPathPtr> m_HeaderPaths;
 	std::map<std::string, SourceFilePtr> m_SourceFiles;
 	std::map<std::string, SourceFilePtr> m_ResourceFiles;
+	std::map<Platform::Type, ResourceOptions> m_ResourceOptions;
 	std::map<std::string, DefinePtr> m_Defines;
 	std::set<std::string> m_Imports;
 	std::map<std::string, std::string> m_OSXFrameworks;
@@ -335,6 +366,8 @@ private:
 
 	Project(const Project &) = delete;
 	Project & operator=(const Project &) = delete;
+
+	friend class ProjectSnapshot;
 };
 
 typedef std::shared_ptr<Project> ProjectPtr;
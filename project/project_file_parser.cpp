@@ -21,12 +21,24 @@
 // THE SOFTWARE.
 //
 #include "project_file_parser.h"
+#include "project_snapshot.h"
 #include "../config.h"
 #include "../util/image.h"
 #include "../util/cxx-util/cxx-util/fmt.h"
 #include "../util/path-util/path-util.h"
+#include "../util/stat_cache.h"
+#include "../util/thread_pool.h"
+#include "../util/glob.h"
 #include <unordered_map>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <future>
 #include <cassert>
+#include <cstring>
 #include <stdexcept>
 #include <sstream>
 #include <iostream>
@@ -63,6 +75,333 @@ struct ProjectFileParser::Error : public std::runtime_error
   #endif
 };
 
+struct ProjectFileParser::Location
+{
+	const std::string & fileName;
+	int line;
+
+	inline Location(const std::string & file, int l) : fileName(file), line(l) {}
+
+	inline std::string format(const std::string & message) const
+		{ return fmt() << fileName << '(' << line << "): " << message; }
+
+	inline void reportWarning(Project & project, const std::string & message) const
+	{
+		std::cerr << format(message) << std::endl;
+		project.setValid(false);
+	}
+};
+
+enum class ProjectFileParser::ChangeType
+{
+	Warning = 0,				// text: message
+	ProjectFile,				// text: file name; numbers: modification time
+	SetString,					// text: value; numbers: index in g_StringSetters
+	SourceFile,					// file
+	ResourceFile,				// file
+	IncludeWrapper,				// text: name, path
+	Define,						// text: name; numbers: platforms, build types
+	Import,						// text: url, name
+	Include,					// text: path, path prefix; numbers: platform
+	ResourceEmbedding,			// numbers: platforms, embedding
+	ResourceShardSize,			// numbers: platforms, shard size
+	ResourceHotReload,			// numbers: platforms, flag
+	IOSFramework,				// text: name, path
+	OSXFramework,				// text: name, path
+	IOSIcon,					// text: path; numbers: image size
+	OSXIcon,					// text: path; numbers: image size
+	IOSLaunchImage,				// text: path; numbers: image size
+	IOSResetDevices,
+	IOSAllowIPhone,
+	IOSAllowIPad,
+	IOSViewController,			// text: name, parent class, project file
+	IOSViewControllerFamily,	// text: family; numbers: index in g_IOSViewControllerLayouts
+	IOSViewControllerLayout,	// text: name, path; numbers: index in g_IOSViewControllerLayouts or -1 for all
+	IOSAddViewController,
+	AndroidMinSdkVersion,		// numbers: version
+	AndroidTargetSdkVersion,	// numbers: version
+	AndroidMakeActivity,		// text: name, parent class
+	AndroidView,				// text: name
+	AndroidViewFamily,			// text: family; numbers: index in g_AndroidViewLayouts
+	AndroidViewLayout,			// text: name, path; numbers: index in g_AndroidViewLayouts
+	AndroidAddView,
+	AndroidIcon,				// text: path; numbers: image size
+	ToDo,						// text: message; numbers: year, month, day
+	TranslationFile,			// text: language, file name, path
+	Count
+};
+
+static void (Project::* const g_StringSetters[])(const std::string &) = {
+	&Project::addScannedDirectory,
+	&Project::setProjectName,
+	&Project::addLicense,
+	&Project::winrtAddLibrary,
+	&Project::tizenAddPrivilege,
+	&Project::iosSetDeploymentTarget,
+	&Project::osxSetDeploymentTarget,
+	&Project::iosAddFont,
+	&Project::iosSetBundleIdentifier,
+	&Project::osxSetBundleIdentifier,
+	&Project::iosSetBundleVersion,
+	&Project::osxSetBundleVersion,
+	&Project::iosSetBundleDisplayName,
+	&Project::iosSetFacebookAppID,
+	&Project::iosSetFacebookDisplayName,
+	&Project::iosSetVkAppID,
+	&Project::androidSetTarget,
+	&Project::androidSetPackage,
+	&Project::androidSetDisplayName,
+	&Project::androidSetGlEsVersion,
+	&Project::androidAddNativeLib,
+	&Project::androidAddManifestActivity,
+	&Project::androidAddJavaSourceDir,
+};
+
+static SourceFilePtr Project::IOSViewController::* const g_IOSViewControllerLayouts[] = {
+	&Project::IOSViewController::iphone,
+	&Project::IOSViewController::ipad,
+};
+
+static SourceFilePtr Project::AndroidView::* const g_AndroidViewLayouts[] = {
+	&Project::AndroidView::phone,
+	&Project::AndroidView::tablet7,
+	&Project::AndroidView::tablet10,
+};
+
+// Changes are plain data, so that they could be stored in the project snapshot
+struct ProjectFileParser::Change
+{
+	ChangeType type;
+	int line;
+	bool warn;						// Errors are reported as warnings
+	std::vector<std::string> text;
+	std::vector<int64_t> numbers;
+	SourceFilePtr file;
+
+	inline Change(ChangeType t, int l) : type(t), line(l), warn(false) {}
+};
+
+// Project files are not parsed directly into the project. Instead, parser records changes to the project along
+// with their locations, and these changes are applied later in order. This allows imported project files to be
+// parsed in parallel, while the resulting project (including warnings and errors) stays the same as if all
+// files were parsed sequentially.
+struct ProjectFileParser::Fragment
+{
+	std::string fileName;
+	std::vector<Change> changes;
+	ImportQueue * imports = nullptr;
+	std::exception_ptr error;		// Error that has stopped the parser
+	std::string gitError;			// Error that has prevented opening of the git repository
+};
+
+// Parses imported and included project files in background threads
+class ProjectFileParser::ImportQueue
+{
+public:
+	inline ImportQueue(const YipDirectoryPtr & yipDirectory, const std::map<std::string, std::string> & cache,
+			bool resolveImports)
+		: m_YipDirectory(yipDirectory),
+		  m_CachedFragments(cache),
+		  m_ResolveImports(resolveImports)
+	{
+	}
+
+	inline const YipDirectoryPtr & yipDirectory() const { return m_YipDirectory; }
+	inline bool resolveImports() const { return m_ResolveImports; }
+
+	void request(const std::string & url, const std::string & name)
+	{
+		std::string key = url + '\n' + name;
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_Fragments.find(key) != m_Fragments.end())
+			return;
+
+		std::shared_ptr<std::promise<FragmentPtr>> promise = std::make_shared<std::promise<FragmentPtr>>();
+		m_Fragments.insert(std::make_pair(key, promise->get_future().share()));
+
+		if (!m_ThreadPool)
+			m_ThreadPool.reset(new ThreadPool(g_Config->jobs));
+		m_ThreadPool->run([this, url, name, promise]() {
+			FragmentPtr fragment = std::make_shared<Fragment>();
+			try
+			{
+				GitRepositoryPtr repo;
+				try {
+					std::lock_guard<std::mutex> gitLock(m_GitMutex);
+					repo = m_YipDirectory->openGitRepository(url);
+				} catch (const std::exception & e) {
+					fragment->gitError = fmt() << "unable to open git repository at '" << url << "': " << e.what();
+				}
+
+				if (repo)
+					ProjectFileParser::parseFromGit(fragment, name, repo, Platform::All, this);
+			}
+			catch (...)
+			{
+				fragment->error = std::current_exception();
+			}
+			promise->set_value(fragment);
+		});
+	}
+
+	FragmentPtr fragment(const std::string & url, const std::string & name)
+	{
+		return wait(url + '\n' + name);
+	}
+
+	void requestInclude(const std::string & path, const std::string & pathPrefix, Platform::Type platform)
+	{
+		std::string key = includeKey(path, pathPrefix, platform);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_Fragments.find(key) != m_Fragments.end())
+			return;
+
+		std::shared_ptr<std::promise<FragmentPtr>> promise = std::make_shared<std::promise<FragmentPtr>>();
+		m_Fragments.insert(std::make_pair(key, promise->get_future().share()));
+
+		if (!m_ThreadPool)
+			m_ThreadPool.reset(new ThreadPool(g_Config->jobs));
+		m_ThreadPool->run([this, key, path, pathPrefix, platform, promise]() {
+			FragmentPtr fragment = std::make_shared<Fragment>();
+			fragment->fileName = path;
+			try
+			{
+				if (!restore(key, *fragment))
+				{
+					ProjectFileParser parser(path, pathPrefix, platform);
+					parser.doParse(fragment, this);
+				}
+			}
+			catch (...)
+			{
+				fragment->error = std::current_exception();
+			}
+			store(key, fragment);
+			promise->set_value(fragment);
+		});
+	}
+
+	FragmentPtr includedFragment(const std::string & path, const std::string & pathPrefix, Platform::Type platform)
+	{
+		return wait(includeKey(path, pathPrefix, platform));
+	}
+
+	// Waits for all requested files to be parsed
+	std::map<std::string, std::string> parsedFragments()
+	{
+		std::vector<std::shared_future<FragmentPtr>> futures;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			for (const auto & it : m_Fragments)
+				futures.push_back(it.second);
+		}
+		for (const auto & future : futures)
+			future.wait();
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_ParsedFragments;
+	}
+
+private:
+	YipDirectoryPtr m_YipDirectory;
+	const std::map<std::string, std::string> & m_CachedFragments;
+	std::map<std::string, std::string> m_ParsedFragments;
+	std::mutex m_Mutex;
+	std::mutex m_GitMutex;
+	std::map<std::string, std::shared_future<FragmentPtr>> m_Fragments;
+	bool m_ResolveImports;
+	std::unique_ptr<ThreadPool> m_ThreadPool;	// Destroyed first, so running tasks could use other members
+
+	static std::string includeKey(const std::string & path, const std::string & pathPrefix,
+		Platform::Type platform)
+	{
+		return fmt() << "include\n" << path << '\n' << pathPrefix << '\n' << platform;
+	}
+
+	// Uses the previous parse result of the file if none of the files it depends on has changed
+	bool restore(const std::string & key, Fragment & fragment)
+	{
+		auto it = m_CachedFragments.find(key);
+		if (it == m_CachedFragments.end())
+			return false;
+
+		Fragment cached;
+		try
+		{
+			BinaryReader reader(it->second);
+			if (!readFragment(reader, cached, m_YipDirectory))
+				return false;
+		}
+		catch (const std::exception & e)
+		{
+			std::cerr << "warning: unable to restore parse result of '" << fragment.fileName << "': "
+				<< e.what() << std::endl;
+			return false;
+		}
+
+		// Repeat side effects of parsing the file
+		cached.imports = this;
+		for (Change & change : cached.changes)
+		{
+			switch (change.type)
+			{
+			case ChangeType::ProjectFile:
+				change.numbers[0] = static_cast<int64_t>(cachedPathGetModificationTime(change.text[0]));
+				break;
+			case ChangeType::IncludeWrapper:
+				m_YipDirectory->writeIncludeWrapper(change.text[0], change.text[1]);
+				break;
+			case ChangeType::Import:
+				if (m_ResolveImports)
+					request(change.text[0], change.text[1]);
+				break;
+			case ChangeType::Include:
+				requestInclude(change.text[0], change.text[1], static_cast<Platform::Type>(change.numbers[0]));
+				break;
+			default:
+				break;
+			}
+		}
+
+		fragment = std::move(cached);
+		return true;
+	}
+
+	// Parse results are stored only for files that have been parsed successfully
+	void store(const std::string & key, const FragmentPtr & fragment)
+	{
+		if (fragment->error)
+			return;
+
+		BinaryWriter writer;
+		try {
+			writeFragment(writer, *fragment, m_YipDirectory);
+		} catch (const std::exception & e) {
+			std::cerr << "warning: unable to store parse result of '" << fragment->fileName << "': "
+				<< e.what() << std::endl;
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_ParsedFragments[key] = writer.data();
+	}
+
+	FragmentPtr wait(const std::string & key)
+	{
+		std::shared_future<FragmentPtr> future;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			future = m_Fragments.at(key);
+		}
+		return future.get();
+	}
+
+	ImportQueue(const ImportQueue &) = delete;
+	ImportQueue & operator=(const ImportQueue &) = delete;
+};
+
 static bool isValidPathPrefix(const std::string & prefix)
 {
 	if (prefix.length() == 0)
@@ -86,7 +425,10 @@ static bool isValidPathPrefix(const std::string & prefix)
 
 ProjectFileParser::ProjectFileParser(const std::string & filename, const std::string & pathPrefix,
 		Platform::Type platform)
-	: m_FileName(pathMakeAbsolute(filename)),
+	: m_File(filename),
+	  m_Cur(m_File.data()),
+	  m_End(m_File.data() + m_File.size()),
+	  m_FileName(pathMakeAbsolute(filename)),
 	  m_PathPrefix(pathPrefix),
 	  m_ProjectPath(pathGetDirectory(m_FileName)),
 	  m_DefaultPlatformMask(platform),
@@ -94,12 +436,9 @@ ProjectFileParser::ProjectFileParser(const std::string & filename, const std::st
 	  m_CurLine(1),
 	  m_TokenLine(1),
 	  m_LastChar(0),
-	  m_ResolveImports(false)
+	  m_ResolveImports(false),
+	  m_TokenPushedBack(false)
 {
-	m_Stream.open(filename, std::ios::in);
-	if (!m_Stream.is_open() || m_Stream.fail() || m_Stream.bad())
-		throw std::runtime_error(fmt() << "unable to open file '" << filename << "'.");
-
 	m_CommandHandlers.insert(std::make_pair("project_name", &ProjectFileParser::parseProjectName));
 	m_CommandHandlers.insert(std::make_pair("sources", &ProjectFileParser::parseSources));
 	m_CommandHandlers.insert(std::make_pair("app_sources", &ProjectFileParser::parseAppSources));
@@ -107,9 +446,11 @@ ProjectFileParser::ProjectFileParser(const std::string & filename, const std::st
 	m_CommandHandlers.insert(std::make_pair("defines", &ProjectFileParser::parseDefines));
 	m_CommandHandlers.insert(std::make_pair("app_defines", &ProjectFileParser::parseAppDefines));
 	m_CommandHandlers.insert(std::make_pair("import", &ProjectFileParser::parseImport));
+	m_CommandHandlers.insert(std::make_pair("include", &ProjectFileParser::parseInclude));
 	m_CommandHandlers.insert(std::make_pair("resources", &ProjectFileParser::parseResources));
 	m_CommandHandlers.insert(std::make_pair("resources_dir", &ProjectFileParser::parseResourcesDir));
 	m_CommandHandlers.insert(std::make_pair("app_resources", &ProjectFileParser::parseAppResources));
+	m_CommandHandlers.insert(std::make_pair("resource_options", &ProjectFileParser::parseResourceOptions));
 	m_CommandHandlers.insert(std::make_pair("winrt", &ProjectFileParser::parseWinRT));
 	m_CommandHandlers.insert(std::make_pair("ios", &ProjectFileParser::parseIOSorOSX));
 	m_CommandHandlers.insert(std::make_pair("osx", &ProjectFileParser::parseIOSorOSX));
@@ -126,8 +467,11 @@ ProjectFileParser::~ProjectFileParser()
 
 void ProjectFileParser::parse(const ProjectPtr & project, const std::string & filename, bool resolveImports)
 {
-	ProjectFileParser parser(filename);
-	parser.doParse(project, resolveImports);
+	ImportQueue imports(project->yipDirectory(), project->cachedFragments(), resolveImports);
+	std::string path = pathSimplify(pathMakeAbsolute(filename));
+	imports.requestInclude(path, std::string(), Platform::All);
+	apply(imports.includedFragment(path, std::string(), Platform::All), *project);
+	project->addParsedFragments(imports.parsedFragments());
 }
 
 void ProjectFileParser::parseFromCurrentDirectory(const ProjectPtr & project, bool resolveImports)
@@ -137,6 +481,27 @@ void ProjectFileParser::parseFromCurrentDirectory(const ProjectPtr & project, bo
 
 void ProjectFileParser::parseFromGit(const ProjectPtr & project, const std::string & name,
 	const GitRepositoryPtr & repo, Platform::Type platform)
+{
+	ImportQueue imports(project->yipDirectory(), project->cachedFragments(), true);
+	FragmentPtr fragment = std::make_shared<Fragment>();
+	parseFromGit(fragment, name, repo, platform, &imports);
+	apply(fragment, *project);
+	project->addParsedFragments(imports.parsedFragments());
+}
+
+void ProjectFileParser::parseFromGit(const ProjectPtr & project, const std::string & url, Platform::Type platform)
+{
+	GitRepositoryPtr repo;
+	try {
+		repo = project->yipDirectory()->openGitRepository(url);
+	} catch (const std::exception & e) {
+		throw std::runtime_error(fmt() << "unable to open git repository at '" << url << "': " << e.what());
+	}
+	parseFromGit(project, url, repo, platform);
+}
+
+void ProjectFileParser::parseFromGit(const FragmentPtr & fragment, const std::string & name,
+	const GitRepositoryPtr & repo, Platform::Type platform, ImportQueue * imports)
 {
 	std::string file = pathConcat(repo->path(), g_Config->projectFileName);
 
@@ -153,24 +518,315 @@ void ProjectFileParser::parseFromGit(const ProjectPtr & project, const std::stri
 	pathPrefix = pathConcat(".yip-imports", pathPrefix);
 
 	ProjectFileParser parser(file, pathPrefix, platform);
-	parser.doParse(project, true);
+	parser.doParse(fragment, imports);
 }
 
-void ProjectFileParser::parseFromGit(const ProjectPtr & project, const std::string & url, Platform::Type platform)
+void ProjectFileParser::apply(const FragmentPtr & fragment, Project & project)
 {
-	GitRepositoryPtr repo;
-	try {
-		repo = project->yipDirectory()->openGitRepository(url);
-	} catch (const std::exception & e) {
-		throw std::runtime_error(fmt() << "unable to open git repository at '" << url << "': " << e.what());
+	// View controllers and views are declared by several consecutive changes
+	Project::IOSViewController cntrl;
+	Project::AndroidView view;
+
+	for (const Change & change : fragment->changes)
+	{
+		Location location(fragment->fileName, change.line);
+		try {
+			applyChange(change, location, project, fragment->imports, cntrl, view);
+		} catch (const Error &) {
+			throw;
+		} catch (const std::exception & e) {
+			if (!change.warn)
+				throw Error(location.format(e.what()));
+			location.reportWarning(project, e.what());
+		}
+	}
+
+	if (fragment->error)
+		std::rethrow_exception(fragment->error);
+}
+
+void ProjectFileParser::applyChange(const Change & change, const Location & location, Project & project,
+	ImportQueue * imports, Project::IOSViewController & cntrl, Project::AndroidView & view)
+{
+	const std::vector<std::string> & text = change.text;
+	const std::vector<int64_t> & numbers = change.numbers;
+
+	switch (change.type)
+	{
+	case ChangeType::Warning:
+		location.reportWarning(project, text[0]);
+		return;
+
+	case ChangeType::ProjectFile: {
+		time_t modificationTime = static_cast<time_t>(numbers[0]);
+		if (!project.hasModificationTime() || modificationTime > project.modificationTime())
+			project.setModificationTime(modificationTime);
+		project.addProjectFile(text[0]);
+		return;
+		}
+
+	case ChangeType::SetString:
+		(project.*g_StringSetters[numbers[0]])(text[0]);
+		return;
+
+	case ChangeType::SourceFile:
+		project.addSourceFile(change.file);
+		return;
+
+	case ChangeType::ResourceFile:
+		project.addResourceFile(change.file);
+		return;
+
+	case ChangeType::IncludeWrapper:
+		project.addIncludeWrapper(text[0], text[1]);
+		return;
+
+	case ChangeType::Define:
+		project.addDefine(text[0], static_cast<Platform::Type>(numbers[0]),
+			static_cast<BuildType::Value>(numbers[1]));
+		return;
+
+	case ChangeType::Import: {
+		const std::string & url = text[0];
+		if (!project.addImport(url))
+			return;
+
+		if (!imports->resolveImports())
+			return;
+
+		FragmentPtr fragment = imports->fragment(url, text[1]);
+		if (!fragment->gitError.empty())
+			throw std::runtime_error(fragment->gitError);
+
+		try {
+			apply(fragment, project);
+		} catch (const std::exception & e) {
+			location.reportWarning(project,
+				fmt() << "unable to parse project file in git repository at '" << url << "': " << e.what());
+		}
+		return;
+		}
+
+	case ChangeType::Include:
+		if (project.projectFiles().find(text[0]) != project.projectFiles().end())
+			return;
+		apply(imports->includedFragment(text[0], text[1], static_cast<Platform::Type>(numbers[0])), project);
+		return;
+
+	case ChangeType::ResourceEmbedding:
+	case ChangeType::ResourceShardSize:
+	case ChangeType::ResourceHotReload:
+		for (Platform::Type platform = 1; platform < Platform::All; platform <<= 1)
+		{
+			if (!(static_cast<Platform::Type>(numbers[0]) & platform))
+				continue;
+
+			ResourceOptions & options = project.resourceOptions(platform);
+			if (change.type == ChangeType::ResourceEmbedding)
+				options.embedding = static_cast<ResourceEmbedding>(numbers[1]);
+			else if (change.type == ChangeType::ResourceShardSize)
+				options.shardSize = static_cast<size_t>(numbers[1]);
+			else
+				options.hotReload = (numbers[1] != 0);
+		}
+		return;
+
+	case ChangeType::IOSFramework:
+		project.iosAddFramework(text[0], text[1]);
+		return;
+
+	case ChangeType::OSXFramework:
+		project.osxAddFramework(text[0], text[1]);
+		return;
+
+	case ChangeType::IOSIcon:
+		project.iosAddIcon(static_cast<Project::ImageSize>(numbers[0]), text[0]);
+		return;
+
+	case ChangeType::OSXIcon:
+		project.osxAddIcon(static_cast<Project::ImageSize>(numbers[0]), text[0]);
+		return;
+
+	case ChangeType::IOSLaunchImage:
+		project.iosAddLaunchImage(static_cast<Project::ImageSize>(numbers[0]), text[0]);
+		return;
+
+	case ChangeType::IOSResetDevices:
+		project.iosSetAllowIPad(false);
+		project.iosSetAllowIPhone(false);
+		return;
+
+	case ChangeType::IOSAllowIPhone:
+		project.iosSetAllowIPhone(true);
+		return;
+
+	case ChangeType::IOSAllowIPad:
+		project.iosSetAllowIPad(true);
+		return;
+
+	case ChangeType::IOSViewController:
+		cntrl = Project::IOSViewController();
+		cntrl.name = text[0];
+		cntrl.parentClass = text[1];
+		cntrl.projectFile = text[2];
+		return;
+
+	case ChangeType::IOSViewControllerFamily:
+		if (cntrl.*g_IOSViewControllerLayouts[numbers[0]])
+			throw std::runtime_error(fmt() << "duplicate family/orientation '" << text[0] << "'.");
+		return;
+
+	case ChangeType::IOSViewControllerLayout:
+		if (numbers[0] >= 0)
+		{
+			SourceFilePtr Project::IOSViewController::* target = g_IOSViewControllerLayouts[numbers[0]];
+			cntrl.*target = project.addUILayoutFile(text[0], text[1], Platform::iOS);
+		}
+		else
+		{
+			cntrl.iphone = project.addUILayoutFile(text[0], text[1], Platform::iOS);
+			cntrl.ipad = project.addUILayoutFile(text[0], text[1], Platform::iOS);
+		}
+		return;
+
+	case ChangeType::IOSAddViewController:
+		project.iosAddViewController(cntrl);
+		project.setShouldImportIOSUtil();
+		return;
+
+	case ChangeType::AndroidMinSdkVersion:
+		project.androidSetMinSdkVersion(static_cast<int>(numbers[0]));
+		return;
+
+	case ChangeType::AndroidTargetSdkVersion:
+		project.androidSetTargetSdkVersion(static_cast<int>(numbers[0]));
+		return;
+
+	case ChangeType::AndroidMakeActivity:
+		if (!project.androidAddMakeActivity(text[0], text[1]))
+			location.reportWarning(project, fmt() << "duplicate 'make_activity' for class '" << text[0] << "'.");
+		return;
+
+	case ChangeType::AndroidView:
+		view = Project::AndroidView();
+		view.name = text[0];
+		return;
+
+	case ChangeType::AndroidViewFamily:
+		if (view.*g_AndroidViewLayouts[numbers[0]])
+			throw std::runtime_error(fmt() << "duplicate family/orientation '" << text[0] << "'.");
+		return;
+
+	case ChangeType::AndroidViewLayout:
+		view.*g_AndroidViewLayouts[numbers[0]] = project.addUILayoutFile(text[0], text[1], Platform::Android);
+		return;
+
+	case ChangeType::AndroidAddView:
+		project.androidAddView(view);
+		project.setShouldImportAndroidUtil();
+		return;
+
+	case ChangeType::AndroidIcon:
+		project.androidAddIcon(static_cast<Project::ImageSize>(numbers[0]), text[0]);
+		return;
+
+	case ChangeType::ToDo:
+		project.addToDo(location.fileName, location.line, text[0], static_cast<int>(numbers[0]),
+			static_cast<int>(numbers[1]), static_cast<int>(numbers[2]));
+		return;
+
+	case ChangeType::TranslationFile:
+		project.addTranslationFile(text[0], text[1], text[2]);
+		project.addTranslationProjectFile(location.fileName);
+		return;
+
+	case ChangeType::Count:
+		break;
+	}
+
+	assert(false);
+}
+
+// Parse result is stored along with the files and directories the parser has read
+void ProjectFileParser::writeFragment(BinaryWriter & writer, const Fragment & fragment,
+	const YipDirectoryPtr & yipDirectory)
+{
+	std::set<std::string> files, dirs;
+	for (const Change & change : fragment.changes)
+	{
+		switch (change.type)
+		{
+		case ChangeType::ProjectFile:
+		case ChangeType::IOSIcon:
+		case ChangeType::OSXIcon:
+		case ChangeType::IOSLaunchImage:
+		case ChangeType::AndroidIcon:
+			files.insert(change.text[0]);
+			break;
+		case ChangeType::SetString:
+			if (g_StringSetters[change.numbers[0]] == &Project::addScannedDirectory)
+				dirs.insert(change.text[0]);
+			break;
+		default:
+			break;
+		}
+	}
+	ProjectSnapshot::writeFileDependencies(writer, yipDirectory, files, dirs);
+
+	writer.writeString(fragment.fileName);
+	writer.writeUInt32(static_cast<uint32_t>(fragment.changes.size()));
+	for (const Change & change : fragment.changes)
+	{
+		writer.writeUInt32(static_cast<uint32_t>(change.type));
+		writer.writeInt64(change.line);
+		writer.writeBool(change.warn);
+		writer.writeUInt32(static_cast<uint32_t>(change.text.size()));
+		for (const std::string & str : change.text)
+			writer.writeString(str);
+		writer.writeUInt32(static_cast<uint32_t>(change.numbers.size()));
+		for (int64_t number : change.numbers)
+			writer.writeInt64(number);
+		writer.writeBool(change.file != nullptr);
+		if (change.file)
+			ProjectSnapshot::writeSourceFile(writer, *change.file);
 	}
-	parseFromGit(project, url, repo, platform);
+}
+
+// Returns false if any of the files the parse result depends on has changed
+bool ProjectFileParser::readFragment(BinaryReader & reader, Fragment & fragment,
+	const YipDirectoryPtr & yipDirectory)
+{
+	bool outdated = false;
+	if (!ProjectSnapshot::checkFileDependencies(reader, yipDirectory, outdated))
+		return false;
+
+	fragment.fileName = reader.readString();
+	for (uint32_t n = reader.readUInt32(); n > 0; n--)
+	{
+		uint32_t type = reader.readUInt32();
+		if (type >= static_cast<uint32_t>(ChangeType::Count))
+			throw std::runtime_error("invalid change type.");
+
+		Change change(static_cast<ChangeType>(type), static_cast<int>(reader.readInt64()));
+		change.warn = reader.readBool();
+		for (uint32_t i = reader.readUInt32(); i > 0; i--)
+			change.text.push_back(reader.readString());
+		for (uint32_t i = reader.readUInt32(); i > 0; i--)
+			change.numbers.push_back(reader.readInt64());
+		if (reader.readBool())
+			change.file = ProjectSnapshot::readSourceFile(reader);
+		fragment.changes.push_back(change);
+	}
+
+	if (!reader.atEnd())
+		throw std::runtime_error("unexpected data after the end of the parse result.");
+
+	return true;
 }
 
 void ProjectFileParser::reportWarning(const std::string & message)
 {
-	std::cerr << m_FileName << '(' << m_TokenLine << "): " << message << std::endl;
-	m_Project->setValid(false);
+	change(ChangeType::Warning, { message });
 }
 
 void ProjectFileParser::reportError(const std::string & message)
@@ -178,46 +834,139 @@ void ProjectFileParser::reportError(const std::string & message)
 	throw Error(fmt() << m_FileName << '(' << m_TokenLine << "): " << message);
 }
 
-void ProjectFileParser::doParse(const ProjectPtr & project, bool resolveImports)
+void ProjectFileParser::doParse(const FragmentPtr & fragment, ImportQueue * imports)
 {
-	time_t modificationTime = pathGetModificationTime(m_FileName);
-	if (!project->hasModificationTime() || modificationTime > project->modificationTime())
-		project->setModificationTime(modificationTime);
+	m_Fragment = fragment;
+	m_Fragment->fileName = m_FileName;
+	m_Fragment->imports = imports;
+	m_Imports = imports;
+	m_ResolveImports = imports->resolveImports();
 
-	m_Project = project.get();
-	m_ResolveImports = resolveImports;
-
-	for (;;)
+	try
 	{
-		switch (getToken())
-		{
-		case Token::Eof:
-			break;
+		time_t modificationTime = cachedPathGetModificationTime(m_FileName);
+		change(ChangeType::ProjectFile, { m_FileName }, { static_cast<int64_t>(modificationTime) });
 
-		case Token::Literal: {
-			auto it = m_CommandHandlers.find(m_TokenText);
-			if (it != m_CommandHandlers.end())
+		for (;;)
+		{
+			switch (getToken())
 			{
-				try {
-					(this->*(it->second))();
-				} catch (const Error &) {
-					throw;
-				} catch (const std::exception & e) {
-					reportError(e.what());
-					return;
+			case Token::Eof:
+				break;
+
+			case Token::Literal: {
+				auto it = m_CommandHandlers.find(m_TokenText);
+				if (it != m_CommandHandlers.end())
+				{
+					try {
+						(this->*(it->second))();
+					} catch (const Error &) {
+						throw;
+					} catch (const std::exception & e) {
+						reportError(e.what());
+						return;
+					}
+					continue;
 				}
-				continue;
-			}
-			goto unexpected;
+				goto unexpected;
+				}
+
+			default:
+			unexpected:
+				reportError(fmt() << "unexpected '" << m_TokenText << "'.");
+				return;
 			}
+			break;
+		}
+	}
+	catch (...)
+	{
+		m_Fragment->error = std::current_exception();
+	}
+}
 
-		default:
-		unexpected:
-			reportError(fmt() << "unexpected '" << m_TokenText << "'.");
-			return;
+ProjectFileParser::Change & ProjectFileParser::change(ChangeType type, std::initializer_list<std::string> text,
+	std::initializer_list<int64_t> numbers)
+{
+	m_Fragment->changes.push_back(Change(type, m_TokenLine));
+	Change & change = m_Fragment->changes.back();
+	change.text = text;
+	change.numbers = numbers;
+	return change;
+}
+
+void ProjectFileParser::change(void (Project::*method)(const std::string &), const std::string & value)
+{
+	size_t count = sizeof(g_StringSetters) / sizeof(g_StringSetters[0]);
+	size_t index = std::find(g_StringSetters, g_StringSetters + count, method) - g_StringSetters;
+	assert(index < count);
+	change(ChangeType::SetString, { value }, { static_cast<int64_t>(index) });
+}
+
+void ProjectFileParser::changeOrWarn(ChangeType type, std::initializer_list<std::string> text,
+	std::initializer_list<int64_t> numbers)
+{
+	change(type, text, numbers).warn = true;
+}
+
+void ProjectFileParser::addSourceFile(const SourceFilePtr & sourceFile)
+{
+	Change & change = this->change(ChangeType::SourceFile);
+	change.warn = true;
+	change.file = sourceFile;
+}
+
+void ProjectFileParser::addResourceFile(const SourceFilePtr & sourceFile)
+{
+	Change & change = this->change(ChangeType::ResourceFile);
+	change.warn = true;
+	change.file = sourceFile;
+}
+
+// Returns names of files matching the pattern, relative to the directory of the project file
+std::vector<std::string> ProjectFileParser::expandGlob(const std::string & pattern)
+{
+	std::string baseDir, rest;
+	size_t maxDepth = globSplit(pattern, baseDir, rest);
+	std::string path = (baseDir.empty() ? m_ProjectPath : pathMakeAbsolute(baseDir, m_ProjectPath));
+
+	std::vector<std::string> files;
+	if (!cachedPathIsExistent(path))
+	{
+		// Project should be parsed again when the directory is created
+		std::string parent = pathGetDirectory(path);
+		while (parent.length() > 0 && !cachedPathIsExistent(parent))
+		{
+			std::string dir = pathGetDirectory(parent);
+			parent = (dir != parent ? dir : std::string());
 		}
-		break;
+		if (parent.length() > 0)
+			change(&Project::addScannedDirectory, parent);
 	}
+	else
+	{
+		// Hidden directories (and the .yip directory in particular) are entered only if the pattern names them
+		bool hidden = globNamesHidden(rest);
+		DirectoryScanner::Result result = m_Imports->yipDirectory()->scanDirectory(path, maxDepth,
+			[hidden](const std::string & dir) {
+				size_t slash = dir.rfind('/');
+				const char * name = dir.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+				return name[0] != '.' || (hidden && strcmp(name, ".yip") != 0);
+			});
+		for (const std::string & dir : result.directories)
+			change(&Project::addScannedDirectory, (dir.empty() ? path : pathConcat(path, dir)));
+
+		for (const std::string & file : result.files)
+		{
+			if (globMatch(rest, file))
+				files.push_back(baseDir.empty() ? file : pathConcat(baseDir, file));
+		}
+	}
+
+	if (files.empty())
+		reportWarning(fmt() << "no files match pattern '" << pattern << "'.");
+
+	return files;
 }
 
 void ProjectFileParser::parseProjectName()
@@ -225,7 +974,7 @@ void ProjectFileParser::parseProjectName()
 	if (getToken() != Token::Literal)
 		reportError(fmt() << "expected project name after 'project_name'.");
 	else
-		m_Project->setProjectName(m_TokenText);
+		change(&Project::setProjectName, m_TokenText);
 }
 
 void ProjectFileParser::parseSources()
@@ -246,23 +995,29 @@ void ProjectFileParser::parseSources()
 		if (m_Token != Token::Literal)
 			reportError("expected file name.");
 
-		std::string name = m_TokenText;
-		std::string path = pathMakeAbsolute(m_TokenText, m_ProjectPath);
-		if (m_PathPrefix.length() > 0)
-			name = pathConcat(m_PathPrefix, name);
+		std::vector<std::string> fileNames;
+		if (globIsPattern(m_TokenText))
+			fileNames = expandGlob(m_TokenText);
+		else
+			fileNames.push_back(m_TokenText);
 
-		SourceFilePtr sourceFile;
-		try {
-			sourceFile = m_Project->addSourceFile(name, path);
+		// Flags apply to every file matching the pattern
+		std::vector<SourceFilePtr> sourceFiles;
+		for (const std::string & fileName : fileNames)
+		{
+			std::string name = fileName;
+			std::string path = pathMakeAbsolute(fileName, m_ProjectPath);
+			if (m_PathPrefix.length() > 0)
+				name = pathConcat(m_PathPrefix, name);
+
+			SourceFilePtr sourceFile = std::make_shared<SourceFile>(name, path);
 			sourceFile->setPlatforms(platforms);
-		} catch (const Error &) {
-			throw;
-		} catch (const std::exception & e) {
-			reportWarning(e.what());
+			addSourceFile(sourceFile);
+			sourceFiles.push_back(sourceFile);
 		}
 
 		getToken();
-		parseFileFlags(sourceFile);
+		parseFileFlags(sourceFiles);
 	}
 
 	if (m_Token != Token::RCurly)
@@ -295,14 +1050,9 @@ void ProjectFileParser::parseAppSources()
 			if (m_PathPrefix.length() > 0)
 				name = pathConcat(m_PathPrefix, name);
 
-			try {
-				sourceFile = m_Project->addSourceFile(name, path);
-				sourceFile->setPlatforms(platforms);
-			} catch (const Error &) {
-				throw;
-			} catch (const std::exception & e) {
-				reportWarning(e.what());
-			}
+			sourceFile = std::make_shared<SourceFile>(name, path);
+			sourceFile->setPlatforms(platforms);
+			addSourceFile(sourceFile);
 		}
 
 		getToken();
@@ -327,27 +1077,17 @@ void ProjectFileParser::parsePublicHeaders()
 		std::string name = m_TokenText;
 		std::string path = pathMakeAbsolute(m_TokenText, m_ProjectPath);
 
-		SourceFilePtr sourceFile;
-		try {
-			sourceFile = m_Project->addSourceFile(pathConcat(m_PathPrefix, name), path);
-		} catch (const Error &) {
-			throw;
-		} catch (const std::exception & e) {
-			reportWarning(e.what());
-		}
+		SourceFilePtr sourceFile = std::make_shared<SourceFile>(pathConcat(m_PathPrefix, name), path);
+		addSourceFile(sourceFile);
 
 		SourceFilePtr sourceFile2;
 		if (m_PathPrefix.length() > 0)
 		{
 			std::string proxyName = pathConcat(".yip-import-proxies/yip-imports", name);
-			std::string proxyPath = m_Project->yipDirectory()->writeIncludeWrapper(proxyName, path);
-			try {
-				sourceFile2 = m_Project->addSourceFile(pathConcat(".yip-imports-proxies", name), proxyPath);
-			} catch (const Error &) {
-				throw;
-			} catch (const std::exception & e) {
-				reportWarning(e.what());
-			}
+			std::string proxyPath = m_Imports->yipDirectory()->writeIncludeWrapper(proxyName, path);
+			change(ChangeType::IncludeWrapper, { proxyName, path });
+			sourceFile2 = std::make_shared<SourceFile>(pathConcat(".yip-imports-proxies", name), proxyPath);
+			addSourceFile(sourceFile2);
 		}
 
 		getToken();
@@ -377,7 +1117,9 @@ void ProjectFileParser::parseDefines()
 	{
 		if (m_Token != Token::Literal)
 			reportError("expected preprocessor definition.");
-		m_Project->addDefine(m_TokenText, platforms, buildTypes);
+
+		change(ChangeType::Define, { m_TokenText }, { platforms, buildTypes });
+
 		getToken();
 	}
 
@@ -406,7 +1148,9 @@ void ProjectFileParser::parseAppDefines()
 			reportError("expected preprocessor definition.");
 
 		if (m_PathPrefix.length() == 0)
-			m_Project->addDefine(m_TokenText, platforms, buildTypes);
+		{
+			change(ChangeType::Define, { m_TokenText }, { platforms, buildTypes });
+		}
 
 		getToken();
 	}
@@ -421,27 +1165,30 @@ void ProjectFileParser::parseImport()
 		reportError("expected dependency name after 'import'.");
 
 	auto it = g_Config->repos.find(m_TokenText);
-	std::string url = (it != g_Config->repos.end() ? it->second : m_TokenText);
-	std::string name = (it != g_Config->repos.end() ? it->first : m_TokenText);
+	std::string url = (it != g_Config->repos.end() ? it->second : m_TokenText.str());
+	std::string name = (it != g_Config->repos.end() ? it->first : m_TokenText.str());
 
-	if (!m_Project->addImport(url))
-		return;
+	// Imported project file is parsed in background; its changes are applied in place of this import
+	if (m_ResolveImports)
+		m_Imports->request(url, name);
 
-	if (!m_ResolveImports)
-		return;
+	change(ChangeType::Import, { url, name });
+}
 
-	GitRepositoryPtr repo;
-	try {
-		repo = m_Project->yipDirectory()->openGitRepository(url);
-	} catch (const std::exception & e) {
-		throw std::runtime_error(fmt() << "unable to open git repository at '" << url << "': " << e.what());
-	}
+void ProjectFileParser::parseInclude()
+{
+	if (getToken() != Token::Literal)
+		reportError("expected file name after 'include'.");
 
-	try {
-		ProjectFileParser::parseFromGit(m_Project->shared_from_this(), name, repo);
-	} catch (const std::exception & e) {
-		reportWarning(fmt() << "unable to parse project file in git repository at '" << url << "': " << e.what());
-	}
+	std::string path = pathSimplify(pathMakeAbsolute(m_TokenText, m_ProjectPath));
+	std::string pathPrefix = m_PathPrefix;
+	Platform::Type platform = m_DefaultPlatformMask;
+
+	// Included file is parsed in background; its changes are applied in place of this include.
+	// Each file is included at most once, so recursive includes are harmless.
+	m_Imports->requestInclude(path, pathPrefix, platform);
+
+	change(ChangeType::Include, { path, pathPrefix }, { platform });
 }
 
 void ProjectFileParser::parseResources()
@@ -465,16 +1212,12 @@ void ProjectFileParser::parseResources()
 		std::string name = m_TokenText;
 		std::string path = pathMakeAbsolute(name, m_ProjectPath);
 
-		try {
-			SourceFilePtr sourceFile = m_Project->addResourceFile(name, path);
-			sourceFile->setPlatforms(platforms);
-		} catch (const Error &) {
-			throw;
-		} catch (const std::exception & e) {
-			reportWarning(e.what());
-		}
+		SourceFilePtr sourceFile = std::make_shared<SourceFile>(name, path);
+		sourceFile->setPlatforms(platforms);
+		addResourceFile(sourceFile);
 
 		getToken();
+		parseFileFlags(sourceFile);
 	}
 
 	if (m_Token != Token::RCurly)
@@ -496,33 +1239,24 @@ void ProjectFileParser::parseResourcesDir()
 	std::string name = m_TokenText;
 	std::string path = pathMakeAbsolute(name, m_ProjectPath);
 
-	std::function<void(const std::string &, const std::string &)> processDir =
-		[&processDir, platforms, this](const std::string & fullname, const std::string & fullpath)
-	{
-		DirEntryList list = pathEnumDirectoryContents(fullpath);
-		for (auto it : list)
-		{
-			std::string resName = pathConcat(fullname, it.name);
-			std::string resPath = pathConcat(fullpath, it.name);
+	DirectoryScanner::Result result = m_Imports->yipDirectory()->scanDirectory(path);
+	for (const std::string & dir : result.directories)
+		change(&Project::addScannedDirectory, (dir.empty() ? path : pathConcat(path, dir)));
 
-			if (it.type == DirEntry_Directory)
-			{
-				processDir(resName, resPath);
-				continue;
-			}
-
-			try {
-				SourceFilePtr sourceFile = m_Project->addResourceFile(resName, resPath);
-				sourceFile->setPlatforms(platforms);
-			} catch (const Error &) {
-				throw;
-			} catch (const std::exception & e) {
-				reportWarning(e.what());
-			}
-		}
-	};
+	std::vector<SourceFilePtr> files;
+	files.reserve(result.files.size());
+	for (const std::string & file : result.files)
+	{
+		SourceFilePtr sourceFile = std::make_shared<SourceFile>(pathConcat(name, file), pathConcat(path, file));
+		sourceFile->setPlatforms(platforms);
+		addResourceFile(sourceFile);
+		files.push_back(sourceFile);
+	}
 
-	processDir(name, path);
+	// Flags are optional and apply to every file in the directory
+	getToken();
+	parseFileFlags(files);
+	ungetToken();
 }
 
 void ProjectFileParser::parseAppResources()
@@ -546,19 +1280,70 @@ void ProjectFileParser::parseAppResources()
 		std::string name = m_TokenText;
 		std::string path = pathMakeAbsolute(name, m_ProjectPath);
 
+		SourceFilePtr sourceFile;
 		if (m_PathPrefix.length() == 0)
 		{
-			try {
-				SourceFilePtr sourceFile = m_Project->addResourceFile(name, path);
-				sourceFile->setPlatforms(platforms);
-			} catch (const Error &) {
-				throw;
-			} catch (const std::exception & e) {
-				reportWarning(e.what());
-			}
+			sourceFile = std::make_shared<SourceFile>(name, path);
+			sourceFile->setPlatforms(platforms);
+			addResourceFile(sourceFile);
 		}
 
 		getToken();
+		parseFileFlags(sourceFile);
+	}
+
+	if (m_Token != Token::RCurly)
+		reportError("expected '}'.");
+}
+
+void ProjectFileParser::parseResourceOptions()
+{
+	Platform::Type platforms = m_DefaultPlatformMask;
+	if (getToken() == Token::Colon)
+	{
+		getToken();
+		platforms = parsePlatformMask();
+	}
+
+	if (m_Token != Token::LCurly)
+		{ reportError("expected '{'."); return; }
+
+	getToken();
+	while (m_Token != Token::RCurly && m_Token != Token::Eof)
+	{
+		if (m_Token != Token::Literal)
+			{ reportError("expected option name."); return; }
+		std::string name = m_TokenText;
+
+		if (getToken() != Token::Equal)
+			{ reportError("expected '='."); return; }
+
+		if (getToken() != Token::Literal)
+			{ reportError("expected option value."); return; }
+		std::string value = m_TokenText;
+
+		if (name == "embed")
+		{
+			ResourceEmbedding embedding = resourceEmbeddingFromString(value);
+			change(ChangeType::ResourceEmbedding, {}, { platforms, static_cast<int64_t>(embedding) });
+		}
+		else if (name == "shard_size")
+		{
+			size_t shardSize = resourceShardSizeFromString(value);
+			change(ChangeType::ResourceShardSize, {}, { platforms, static_cast<int64_t>(shardSize) });
+		}
+		else if (name == "hot_reload")
+		{
+			if (value != "yes" && value != "no")
+				reportError(fmt() << "invalid value '" << value << "' for option 'hot_reload'.");
+			bool hotReload = (value == "yes");
+			change(ChangeType::ResourceHotReload, {}, { platforms, hotReload });
+		}
+		else
+			reportWarning(fmt() << "invalid resource option '" << name << "'.");
+
+		if (getToken() == Token::Comma)
+			getToken();
 	}
 
 	if (m_Token != Token::RCurly)
@@ -579,7 +1364,7 @@ void ProjectFileParser::parseWinRT()
 	{
 		if (getToken() != Token::Literal)
 			{ reportError(fmt() << "expected library name after '" << prefix << ":library'."); return; }
-		m_Project->winrtAddLibrary(m_TokenText);
+		change(&Project::winrtAddLibrary, m_TokenText);
 		return;
 	}
 
@@ -625,21 +1410,7 @@ void ProjectFileParser::parseIOSorOSX()
 				path = pathMakeAbsolute(path, m_ProjectPath);
 		}
 
-		try
-		{
-			if (iOS)
-				m_Project->iosAddFramework(name, path);
-			else
-				m_Project->osxAddFramework(name, path);
-		}
-		catch (const Error &)
-		{
-			throw;
-		}
-		catch (const std::exception & e)
-		{
-			reportWarning(e.what());
-		}
+		changeOrWarn(iOS ? ChangeType::IOSFramework : ChangeType::OSXFramework, { name, path });
 
 		return;
 	}
@@ -649,9 +1420,9 @@ void ProjectFileParser::parseIOSorOSX()
 			{ reportError(fmt() << "expected deployment target after '" << prefix << ":deployment_target'."); return; }
 
 		if (iOS)
-			m_Project->iosSetDeploymentTarget(m_TokenText);
+			change(&Project::iosSetDeploymentTarget, m_TokenText);
 		else
-			m_Project->osxSetDeploymentTarget(m_TokenText);
+			change(&Project::osxSetDeploymentTarget, m_TokenText);
 
 		return;
 	}
@@ -688,21 +1459,7 @@ void ProjectFileParser::parseIOSorOSX()
 		if (imageSize == Project::IMAGESIZE_INVALID)
 			return;
 
-		try
-		{
-			if (iOS)
-				m_Project->iosAddIcon(imageSize, path);
-			else
-				m_Project->osxAddIcon(imageSize, path);
-		}
-		catch (const Error &)
-		{
-			throw;
-		}
-		catch (const std::exception & e)
-		{
-			reportWarning(e.what());
-		}
+		changeOrWarn(iOS ? ChangeType::IOSIcon : ChangeType::OSXIcon, { path }, { imageSize });
 
 		return;
 	}
@@ -734,13 +1491,7 @@ void ProjectFileParser::parseIOSorOSX()
 		if (imageSize == Project::IMAGESIZE_INVALID)
 			return;
 
-		try {
-			m_Project->iosAddLaunchImage(imageSize, path);
-		} catch (const Error &) {
-			throw;
-		} catch (const std::exception & e) {
-			reportWarning(e.what());
-		}
+		changeOrWarn(ChangeType::IOSLaunchImage, { path }, { imageSize });
 
 		return;
 	}
@@ -749,7 +1500,7 @@ void ProjectFileParser::parseIOSorOSX()
 		if (getToken() != Token::Literal)
 			{ reportError(fmt() << "expected font path after '" << prefix << ":font'."); return; }
 
-		m_Project->iosAddFont(m_TokenText);
+		change(&Project::iosAddFont, m_TokenText);
 
 		return;
 	}
@@ -759,9 +1510,9 @@ void ProjectFileParser::parseIOSorOSX()
 			{ reportError(fmt() << "expected bundle identifier after '" << prefix << ":bundle_id'."); return; }
 
 		if (iOS)
-			m_Project->iosSetBundleIdentifier(m_TokenText);
+			change(&Project::iosSetBundleIdentifier, m_TokenText);
 		else
-			m_Project->osxSetBundleIdentifier(m_TokenText);
+			change(&Project::osxSetBundleIdentifier, m_TokenText);
 
 		return;
 	}
@@ -771,9 +1522,9 @@ void ProjectFileParser::parseIOSorOSX()
 			{ reportError(fmt() << "expected bundle version after '" << prefix << ":bundle_ver'."); return; }
 
 		if (iOS)
-			m_Project->iosSetBundleVersion(m_TokenText);
+			change(&Project::iosSetBundleVersion, m_TokenText);
 		else
-			m_Project->osxSetBundleVersion(m_TokenText);
+			change(&Project::osxSetBundleVersion, m_TokenText);
 
 		return;
 	}
@@ -781,13 +1532,12 @@ void ProjectFileParser::parseIOSorOSX()
 	{
 		if (getToken() != Token::Literal)
 			{ reportError(fmt() << "expected display name after '" << prefix << ":display_name'."); return; }
-		m_Project->iosSetBundleDisplayName(m_TokenText);
+		change(&Project::iosSetBundleDisplayName, m_TokenText);
 		return;
 	}
 	else if (m_TokenText == "supported_devices" && iOS)
 	{
-		m_Project->iosSetAllowIPad(false);
-		m_Project->iosSetAllowIPhone(false);
+		change(ChangeType::IOSResetDevices);
 
 		if (getToken() != Token::LParen)
 			{ reportError("expected '('."); return; }
@@ -798,9 +1548,9 @@ void ProjectFileParser::parseIOSorOSX()
 				{ reportError("expected device family name."); return; }
 
 			if (m_TokenText == "iphone")
-				m_Project->iosSetAllowIPhone(true);
+				change(ChangeType::IOSAllowIPhone);
 			else if (m_TokenText == "ipad")
-				m_Project->iosSetAllowIPad(true);
+				change(ChangeType::IOSAllowIPad);
 			else
 				{ reportError(fmt() << "invalid device family name '" << m_TokenText << "'."); }
 
@@ -824,7 +1574,7 @@ void ProjectFileParser::parseIOSorOSX()
 		if (getToken() != Token::Literal)
 			{ reportError(fmt() << "expected literal after '" << prefix << ":facebook_app_id'."); return; }
 
-		m_Project->iosSetFacebookAppID(m_TokenText);
+		change(&Project::iosSetFacebookAppID, m_TokenText);
 
 		return;
 	}
@@ -833,7 +1583,7 @@ void ProjectFileParser::parseIOSorOSX()
 		if (getToken() != Token::Literal)
 			{ reportError(fmt() << "expected literal after '" << prefix << ":facebook_display_name'."); return; }
 
-		m_Project->iosSetFacebookDisplayName(m_TokenText);
+		change(&Project::iosSetFacebookDisplayName, m_TokenText);
 
 		return;
 	}
@@ -842,26 +1592,25 @@ void ProjectFileParser::parseIOSorOSX()
 		if (getToken() != Token::Literal)
 			{ reportError(fmt() << "expected literal after '" << prefix << ":vk_app_id'."); return; }
 
-		m_Project->iosSetVkAppID(m_TokenText);
+		change(&Project::iosSetVkAppID, m_TokenText);
 
 		return;
 	}
 	else if (m_TokenText == "view_controller" && iOS)
 	{
-		Project::IOSViewController cntrl;
-
 		if (getToken() != Token::Literal)
 			{ reportError(fmt() << "expected view controller name after '" << prefix << ":view_controller'."); return; }
-		cntrl.name = m_TokenText;
+		std::string className = m_TokenText;
 
-		if (getToken() != Token::Literal)
-			cntrl.parentClass = "UIViewController";
-		else
+		std::string parentClass = "UIViewController";
+		if (getToken() == Token::Literal)
 		{
-			cntrl.parentClass = m_TokenText;
+			parentClass = m_TokenText;
 			getToken();
 		}
 
+		change(ChangeType::IOSViewController, { className, parentClass, m_FileName });
+
 		if (m_Token == Token::Arrow)
 		{
 			if (getToken() != Token::Literal)
@@ -870,14 +1619,7 @@ void ProjectFileParser::parseIOSorOSX()
 			std::string name = m_TokenText;
 			std::string path = pathMakeAbsolute(name, m_ProjectPath);
 
-			try {
-				cntrl.iphone = m_Project->addUILayoutFile(name, path, Platform::iOS);
-				cntrl.ipad = m_Project->addUILayoutFile(name, path, Platform::iOS);
-			} catch (const Error &) {
-				throw;
-			} catch (const std::exception & e) {
-				reportWarning(e.what());
-			}
+			changeOrWarn(ChangeType::IOSViewControllerLayout, { name, path }, { -1 });
 		}
 		else
 		{
@@ -889,16 +1631,15 @@ void ProjectFileParser::parseIOSorOSX()
 				if (getToken() != Token::Literal)
 					{ reportError("expected device family/orientation name."); return; }
 
-				SourceFilePtr * target = nullptr;
+				int64_t target = -1;
 				if (m_TokenText == "iphone")
-					target = &cntrl.iphone;
+					target = 0;
 				else if (m_TokenText == "ipad")
-					target = &cntrl.ipad;
+					target = 1;
 				else
 					{ reportError(fmt() << "invalid device family/orientation name '" << m_TokenText << "'."); }
 
-				if (target->get() != nullptr)
-					{ reportError(fmt() << "duplicate family/orientation '" << m_TokenText << "'."); }
+				change(ChangeType::IOSViewControllerFamily, { m_TokenText }, { target });
 
 				if (getToken() != Token::Arrow)
 					{ reportError("expected '=>'."); return; }
@@ -909,13 +1650,7 @@ void ProjectFileParser::parseIOSorOSX()
 				std::string name = m_TokenText;
 				std::string path = pathMakeAbsolute(name, m_ProjectPath);
 
-				try {
-					*target = m_Project->addUILayoutFile(name, path, Platform::iOS);
-				} catch (const Error &) {
-					throw;
-				} catch (const std::exception & e) {
-					reportWarning(e.what());
-				}
+				changeOrWarn(ChangeType::IOSViewControllerLayout, { name, path }, { target });
 
 				switch (getToken())
 				{
@@ -931,14 +1666,7 @@ void ProjectFileParser::parseIOSorOSX()
 			}
 		}
 
-		try {
-			m_Project->iosAddViewController(cntrl);
-			m_Project->setShouldImportIOSUtil();
-		} catch (const Error &) {
-			throw;
-		} catch (const std::exception & e) {
-			reportWarning(e.what());
-		}
+		changeOrWarn(ChangeType::IOSAddViewController);
 
 		return;
 	}
@@ -960,71 +1688,73 @@ void ProjectFileParser::parseAndroid()
 	{
 		if (getToken() != Token::Literal)
 			{ reportError(fmt() << "expected target name after '" << prefix << ":target'."); return; }
-		m_Project->androidSetTarget(m_TokenText);
+		change(&Project::androidSetTarget, m_TokenText);
 		return;
 	}
 	else if (m_TokenText == "package")
 	{
 		if (getToken() != Token::Literal)
 			{ reportError(fmt() << "expected package name after '" << prefix << ":package'."); return; }
-		m_Project->androidSetPackage(m_TokenText);
+		change(&Project::androidSetPackage, m_TokenText);
 		return;
 	}
 	else if (m_TokenText == "display_name")
 	{
 		if (getToken() != Token::Literal)
 			{ reportError(fmt() << "expected display name after '" << prefix << ":display_name'."); return; }
-		m_Project->androidSetDisplayName(m_TokenText);
+		change(&Project::androidSetDisplayName, m_TokenText);
 		return;
 	}
 	else if (m_TokenText == "gles_version")
 	{
 		if (getToken() != Token::Literal)
 			{ reportError(fmt() << "expected opengl version after '" << prefix << ":gles_version'."); return; }
-		m_Project->androidSetGlEsVersion(m_TokenText);
+		change(&Project::androidSetGlEsVersion, m_TokenText);
 		return;
 	}
 	else if (m_TokenText == "nativelib")
 	{
 		if (getToken() != Token::Literal)
 			{ reportError(fmt() << "expected library name after '" << prefix << ":nativelib'."); return; }
-		m_Project->androidAddNativeLib(m_TokenText);
+		change(&Project::androidAddNativeLib, m_TokenText);
 		return;
 	}
 	else if (m_TokenText == "min_sdk_version")
 	{
 		if (getToken() != Token::Literal)
 			{ reportError(fmt() << "expected minimum SDK version after '" << prefix << ":min_sdk_version'."); return; }
-		const char * p = m_TokenText.c_str(), * end = nullptr;
+		std::string text = m_TokenText;
+		const char * p = text.c_str(), * end = nullptr;
 		long value = strtol(p, (char **)&end, 10);
-		if (end != p + m_TokenText.length() || value <= 0 || value > 1000)
+		if (end != p + text.length() || value <= 0 || value > 1000)
 			{ reportError(fmt() << "invalid value for '" << prefix << ":min_sdk_version'."); return; }
-		m_Project->androidSetMinSdkVersion(int(value));
+		change(ChangeType::AndroidMinSdkVersion, {}, { value });
 		return;
 	}
 	else if (m_TokenText == "target_sdk_version")
 	{
 		if (getToken() != Token::Literal)
 			{ reportError(fmt() << "expected target SDK version after '" << prefix << ":target_sdk_version'."); return; }
-		const char * p = m_TokenText.c_str(), * end = nullptr;
+		std::string text = m_TokenText;
+		const char * p = text.c_str(), * end = nullptr;
 		long value = strtol(p, (char **)&end, 10);
-		if (end != p + m_TokenText.length() || value <= 0 || value > 1000)
+		if (end != p + text.length() || value <= 0 || value > 1000)
 			{ reportError(fmt() << "invalid value for '" << prefix << ":target_sdk_version'."); return; }
-		m_Project->androidSetTargetSdkVersion(int(value));
+		change(ChangeType::AndroidTargetSdkVersion, {}, { value });
 		return;
 	}
 	else if (m_TokenText == "manifest_activity")
 	{
 		if (getToken() != Token::Literal)
 			{ reportError(fmt() << "expected activity XML after '" << prefix << ":manifest_activity'."); return; }
-		m_Project->androidAddManifestActivity(m_TokenText);
+		change(&Project::androidAddManifestActivity, m_TokenText);
 		return;
 	}
 	else if (m_TokenText == "java_srcdir")
 	{
 		if (getToken() != Token::Literal)
 			{ reportError(fmt() << "expected path to the Java source dir after '" << prefix << ":java_srcdir'."); return; }
-		m_Project->androidAddJavaSourceDir(pathMakeAbsolute(m_TokenText, m_ProjectPath));
+		change(&Project::androidAddJavaSourceDir, pathMakeAbsolute(m_TokenText, m_ProjectPath));
 		return;
 	}
 	else if (m_TokenText == "make_activity")
@@ -1037,17 +1767,14 @@ void ProjectFileParser::parseAndroid()
 		if (getToken() != Token::Literal)
 			{ reportError(fmt() << "expected class name after '=>'."); return; }
 		std::string parentClass = m_TokenText;
-		if (!m_Project->androidAddMakeActivity(name, parentClass))
-			reportWarning(fmt() << "duplicate 'make_activity' for class '" << name << "'.");
+		change(ChangeType::AndroidMakeActivity, { name, parentClass });
 		return;
 	}
 	else if (m_TokenText == "view")
 	{
-		Project::AndroidView view;
-
 		if (getToken() != Token::Literal)
 			{ reportError(fmt() << "expected view name after '" << prefix << ":view'."); return; }
-		view.name = m_TokenText;
+		change(ChangeType::AndroidView, { m_TokenText });
 
 		if (getToken() != Token::LCurly)
 			{ reportError("expected '{'."); return; }
@@ -1056,18 +1783,17 @@ void ProjectFileParser::parseAndroid()
 			if (getToken() != Token::Literal)
 				{ reportError("expected device family/orientation name."); return; }
 
-			SourceFilePtr * target = nullptr;
+			int64_t target = -1;
 			if (m_TokenText == "phone")
-				target = &view.phone;
+				target = 0;
 			else if (m_TokenText == "tablet7")
-				target = &view.tablet7;
+				target = 1;
 			else if (m_TokenText == "tablet10")
-				target = &view.tablet10;
+				target = 2;
 			else
 				{ reportError(fmt() << "invalid device family/orientation name '" << m_TokenText << "'."); }
 
-			if (target->get() != nullptr)
-				{ reportError(fmt() << "duplicate family/orientation '" << m_TokenText << "'."); }
+			change(ChangeType::AndroidViewFamily, { m_TokenText }, { target });
 
 			if (getToken() != Token::Arrow)
 				{ reportError("expected '=>'."); return; }
@@ -1078,13 +1804,7 @@ void ProjectFileParser::parseAndroid()
 			std::string name = m_TokenText;
 			std::string path = pathMakeAbsolute(name, m_ProjectPath);
 
-			try {
-				*target = m_Project->addUILayoutFile(name, path, Platform::Android);
-			} catch (const Error &) {
-				throw;
-			} catch (const std::exception & e) {
-				reportWarning(e.what());
-			}
+			changeOrWarn(ChangeType::AndroidViewLayout, { name, path }, { target });
 
 			switch (getToken())
 			{
@@ -1099,14 +1819,7 @@ void ProjectFileParser::parseAndroid()
 			break;
 		}
 
-		try {
-			m_Project->androidAddView(view);
-			m_Project->setShouldImportAndroidUtil();
-		} catch (const Error &) {
-			throw;
-		} catch (const std::exception & e) {
-			reportWarning(e.what());
-		}
+		changeOrWarn(ChangeType::AndroidAddView);
 
 		return;
 	}
@@ -1136,13 +1849,7 @@ void ProjectFileParser::parseAndroid()
 		if (imageSize == Project::IMAGESIZE_INVALID)
 			return;
 
-		try {
-			m_Project->androidAddIcon(imageSize, path);
-		} catch (const Error &) {
-			throw;
-		} catch (const std::exception & e) {
-			reportWarning(e.what());
-		}
+		changeOrWarn(ChangeType::AndroidIcon, { path }, { imageSize });
 
 		return;
 	}
@@ -1164,7 +1871,7 @@ void ProjectFileParser::parseTizen()
 	{
 		if (getToken() != Token::Literal)
 			{ reportError(fmt() << "expected privilege name after '" << prefix << ":privilege'."); return; }
-		m_Project->tizenAddPrivilege(m_TokenText);
+		change(&Project::tizenAddPrivilege, m_TokenText);
 		return;
 	}
 
@@ -1175,7 +1882,7 @@ void ProjectFileParser::parseLicense()
 {
 	if (getToken() != Token::Literal)
 		reportError("expected license text after 'license'.");
-	m_Project->addLicense(m_TokenText);
+	change(&Project::addLicense, m_TokenText);
 }
 
 void ProjectFileParser::parseToDo()
@@ -1201,14 +1908,14 @@ void ProjectFileParser::parseToDo()
 			if (getToken() != Token::Literal)
 				{ reportError("expected date after 'before'."); return; }
 
-			if (sscanf(m_TokenText.c_str(), "%d-%d-%d", &year, &month, &day) != 3
+			if (sscanf(m_TokenText.str().c_str(), "%d-%d-%d", &year, &month, &day) != 3
 					|| year < 0 || month < 0 || day < 0)
 				{ reportError(fmt() << "invalid date '" << m_TokenText << "'."); return; }
 
 			getToken();
 		}
 
-		m_Project->addToDo(m_FileName, m_TokenLine, message, year, month, day);
+		change(ChangeType::ToDo, { message }, { year, month, day });
 
 		if (m_Token == Token::Comma)
 			getToken();
@@ -1229,15 +1936,8 @@ void ProjectFileParser::parseTranslationFile()
 		{ reportError("expected translation file name."); return; }
 	std::string file = m_TokenText;
 
-	try
-	{
-		std::string path = pathMakeAbsolute(file, m_ProjectPath);
-		m_Project->addTranslationFile(language, file, path);
-	}
-	catch (const std::exception & e)
-	{
-		reportError(e.what());
-	}
+	std::string path = pathMakeAbsolute(file, m_ProjectPath);
+	change(ChangeType::TranslationFile, { language, file, path });
 }
 
 Platform::Type ProjectFileParser::parsePlatformMask()
@@ -1325,6 +2025,18 @@ void ProjectFileParser::parseFileFlags(const SourceFilePtr & sourceFile, const S
 {
 	(void)isPublicHeader;
 
+	if (m_Token != Token::LCurly)
+		return;
+
+	std::vector<SourceFilePtr> sourceFiles;
+	if (sourceFile)
+		sourceFiles.push_back(sourceFile);
+	parseFileFlags(sourceFiles, sourceFile2);
+}
+
+void ProjectFileParser::parseFileFlags(const std::vector<SourceFilePtr> & sourceFiles,
+	const SourceFilePtr & sourceFile2)
+{
 	if (m_Token != Token::LCurly)
 		return;
 
@@ -1358,7 +2070,7 @@ void ProjectFileParser::parseFileFlags(const SourceFilePtr & sourceFile, const S
 				reportWarning(fmt() << "invalid file type: '" << value << "'.");
 			else
 			{
-				if (sourceFile)
+				for (const SourceFilePtr & sourceFile : sourceFiles)
 					sourceFile->setFileType(type);
 				if (sourceFile2)
 					sourceFile2->setFileType(type);
@@ -1366,19 +2078,20 @@ void ProjectFileParser::parseFileFlags(const SourceFilePtr & sourceFile, const S
 		}
 		else if (name == "arc")
 		{
-			if (value == "yes")
+			if (value == "yes" || value == "no")
 			{
-				if (sourceFile)
-					sourceFile->setArcEnabled(true);
-			}
-			else if (value == "no")
-			{
-				if (sourceFile)
-					sourceFile->setArcEnabled(false);
+				for (const SourceFilePtr & sourceFile : sourceFiles)
+					sourceFile->setArcEnabled(value == "yes");
 			}
 			else
 				reportWarning(fmt() << "invalid value '" << value << "' for option 'arc'.");
 		}
+		else if (name == "compress")
+		{
+			ResourceCompression compression = resourceCompressionFromString(value);
+			for (const SourceFilePtr & sourceFile : sourceFiles)
+				sourceFile->setCompression(compression);
+		}
 		else
 			reportWarning(fmt() << "invalid file option '" << name << "'.");
 
@@ -1394,6 +2107,7 @@ void ProjectFileParser::parseFileFlags(const SourceFilePtr & sourceFile, const S
 ProjectFileParser::Token ProjectFileParser::getToken()
 {
 	int quote;
+	bool inBuffer;
 
 	#define DIGITS \
 			 '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9'
@@ -1407,14 +2121,21 @@ ProjectFileParser::Token ProjectFileParser::getToken()
 		case 'Y': case 'Z'
 
 	#define EXTRA_SYMBOLS \
-			 '_': case '-': case '+': case '/': case '.': case '~'
+			 '_': case '-': case '+': case '/': case '.': case '~': case '*': case '?'
+
+	if (m_TokenPushedBack)
+	{
+		m_TokenPushedBack = false;
+		return m_Token;
+	}
 
-	m_TokenText.clear();
+	m_TokenText = StringRef();
 	m_Token = Token::Eof;
 	m_TokenLine = m_CurLine;
 
 	for (;;)
 	{
+		const char * tokenStart = m_Cur;
 		int ch = getChar();
 		switch (ch)
 		{
@@ -1431,39 +2152,37 @@ ProjectFileParser::Token ProjectFileParser::getToken()
 			continue;
 
 		case '{':
-			return (m_TokenText = '{', m_Token = Token::LCurly);
+			return (m_TokenText = StringRef(tokenStart, 1), m_Token = Token::LCurly);
 
 		case '}':
-			return (m_TokenText = '}', m_Token = Token::RCurly);
+			return (m_TokenText = StringRef(tokenStart, 1), m_Token = Token::RCurly);
 
 		case '(':
-			return (m_TokenText = '(', m_Token = Token::LParen);
+			return (m_TokenText = StringRef(tokenStart, 1), m_Token = Token::LParen);
 
 		case ')':
-			return (m_TokenText = ')', m_Token = Token::RParen);
+			return (m_TokenText = StringRef(tokenStart, 1), m_Token = Token::RParen);
 
 		case ':':
-			return (m_TokenText = ':', m_Token = Token::Colon);
+			return (m_TokenText = StringRef(tokenStart, 1), m_Token = Token::Colon);
 
 		case '!':
-			return (m_TokenText = '!', m_Token = Token::Exclamation);
+			return (m_TokenText = StringRef(tokenStart, 1), m_Token = Token::Exclamation);
 
 		case ',':
-			return (m_TokenText = ',', m_Token = Token::Comma);
+			return (m_TokenText = StringRef(tokenStart, 1), m_Token = Token::Comma);
 
 		case '=':
 			ch = getChar();
 			if (ch == '>')
-				return (m_TokenText = "=>", m_Token = Token::Arrow);
+				return (m_TokenText = StringRef(tokenStart, 2), m_Token = Token::Arrow);
 			ungetChar();
-			return (m_TokenText = '=', m_Token = Token::Equal);
+			return (m_TokenText = StringRef(tokenStart, 1), m_Token = Token::Equal);
 
 		case LETTERS:
 		case EXTRA_SYMBOLS:
-			m_Buffer.str(std::string());
 			for (;;)
 			{
-				m_Buffer << static_cast<char>(ch);
 				ch = getChar();
 				switch (ch)
 				{
@@ -1478,15 +2197,16 @@ ProjectFileParser::Token ProjectFileParser::getToken()
 				}
 				break;
 			}
-			m_TokenText = m_Buffer.str();
-			m_Buffer.str(std::string());
+			m_TokenText = StringRef(tokenStart, static_cast<size_t>(m_Cur - tokenStart));
 			return (m_Token = Token::Literal);
 
 		case '"':
 		case '\'':
 		case '`':
+			// Literals without escape sequences are referenced in place. Otherwise their text is copied into
+			// the buffer, starting with the part scanned before the first escape sequence.
 			quote = ch;
-			m_Buffer.str(std::string());
+			inBuffer = false;
 			for (;;)
 			{
 				ch = getChar();
@@ -1497,32 +2217,49 @@ ProjectFileParser::Token ProjectFileParser::getToken()
 				case '`':
 					if (ch == quote)
 						break;
-					m_Buffer << static_cast<char>(ch);
+					if (inBuffer)
+						m_Buffer += static_cast<char>(ch);
 					continue;
 				case EOF:
 					reportError("unterminated string literal.");
 					return (m_Token = Token::Eof);
+				case '\r':
 				case '\\':
+					if (!inBuffer)
+					{
+						m_Buffer.assign(tokenStart + 1, m_Cur - 1);
+						inBuffer = true;
+					}
+					if (ch == '\r')
+					{
+						// Line endings are read as in text mode
+						if (m_Cur == m_End || *m_Cur != '\n')
+							m_Buffer += '\r';
+						continue;
+					}
 					ch = getChar();
 					switch (ch)
 					{
-					case 'n': m_Buffer << '\n'; continue;
-					case '\\': m_Buffer << '\\'; continue;
-					case '"': m_Buffer << '"'; continue;
-					case '\'': m_Buffer << '\''; continue;
-					case '`': m_Buffer << '`'; continue;
+					case 'n': m_Buffer += '\n'; continue;
+					case '\\': m_Buffer += '\\'; continue;
+					case '"': m_Buffer += '"'; continue;
+					case '\'': m_Buffer += '\''; continue;
+					case '`': m_Buffer += '`'; continue;
 					default:
 						reportError(fmt() << "invalid escape sequence '\\" << static_cast<char>(ch) << "'.");
 						return (m_Token = Token::Eof);
 					}
 				default:
-					m_Buffer << static_cast<char>(ch);
+					if (inBuffer)
+						m_Buffer += static_cast<char>(ch);
 					continue;
 				}
 				break;
 			}
-			m_TokenText = m_Buffer.str();
-			m_Buffer.str(std::string());
+			if (inBuffer)
+				m_TokenText = StringRef(m_Buffer);
+			else
+				m_TokenText = StringRef(tokenStart + 1, static_cast<size_t>(m_Cur - tokenStart - 2));
 			return (m_Token = Token::Literal);
 
 		default:
@@ -1532,9 +2269,18 @@ ProjectFileParser::Token ProjectFileParser::getToken()
 	}
 }
 
+void ProjectFileParser::ungetToken()
+{
+	assert(!m_TokenPushedBack);
+	m_TokenPushedBack = true;
+}
+
 int ProjectFileParser::getChar()
 {
-	m_LastChar = m_Stream.get();
+	if (m_Cur == m_End)
+		return (m_LastChar = EOF);
+
+	m_LastChar = static_cast<unsigned char>(*m_Cur++);
 	if (m_LastChar == '\n')
 		++m_CurLine;
 	else if (m_LastChar == 0)
@@ -1545,7 +2291,8 @@ int ProjectFileParser::getChar()
 void ProjectFileParser::ungetChar()
 {
 	assert(m_LastChar != 0);
-	m_Stream.unget();
+	if (m_LastChar != EOF)
+		--m_Cur;
 	if (m_LastChar == '\n')
 		--m_CurLine;
 	m_LastChar = 0;
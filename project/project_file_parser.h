@@ -26,10 +26,14 @@
 #include "project.h"
 #include "yip_directory.h"
 #include "platform.h"
+#include "../util/mapped_file.h"
+#include "../util/string_ref.h"
+#include "../util/binary_stream.h"
 #include <unordered_map>
+#include <initializer_list>
+#include <cstdint>
+#include <vector>
 #include <string>
-#include <fstream>
-#include <sstream>
 
 class ProjectFileParser
 {
@@ -50,30 +54,59 @@ protected:
 
 private:
 	enum class Token : int;
+	enum class ChangeType : int;
 
 	struct ImageSize;
 	struct Error;
-
-	std::ifstream m_Stream;
-	Project * m_Project;
+	struct Location;
+	struct Change;
+	struct Fragment;
+	class ImportQueue;
+
+	typedef std::shared_ptr<Fragment> FragmentPtr;
+
+	MappedFile m_File;
+	const char * m_Cur;
+	const char * m_End;
+	FragmentPtr m_Fragment;
+	ImportQueue * m_Imports;
 	std::unordered_map<std::string, void (ProjectFileParser::*)()> m_CommandHandlers;
 	std::string m_FileName;
 	std::string m_PathPrefix;
 	std::string m_ProjectPath;
-	std::stringstream m_Buffer;
-	std::string m_TokenText;
+	std::string m_Buffer;			// Text of string literals containing escape sequences
+	StringRef m_TokenText;			// Points either into the mapped file or into m_Buffer
 	Platform::Type m_DefaultPlatformMask;
 	Token m_Token;
 	int m_CurLine;
 	int m_TokenLine;
 	int m_LastChar;
 	bool m_ResolveImports;
+	bool m_TokenPushedBack;
 
 	ProjectFileParser(const std::string & filename, const std::string & pathPrefix = std::string(),
 		Platform::Type platform = Platform::All);
 	~ProjectFileParser();
 
-	void doParse(const ProjectPtr & project, bool resolveImports);
+	static void parseFromGit(const FragmentPtr & fragment, const std::string & name, const GitRepositoryPtr & repo,
+		Platform::Type platform, ImportQueue * imports);
+	static void apply(const FragmentPtr & fragment, Project & project);
+	static void applyChange(const Change & change, const Location & location, Project & project,
+		ImportQueue * imports, Project::IOSViewController & cntrl, Project::AndroidView & view);
+	static void writeFragment(BinaryWriter & writer, const Fragment & fragment,
+		const YipDirectoryPtr & yipDirectory);
+	static bool readFragment(BinaryReader & reader, Fragment & fragment, const YipDirectoryPtr & yipDirectory);
+
+	void doParse(const FragmentPtr & fragment, ImportQueue * imports);
+
+	Change & change(ChangeType type, std::initializer_list<std::string> text = {},
+		std::initializer_list<int64_t> numbers = {});
+	void change(void (Project::*method)(const std::string &), const std::string & value);
+	void changeOrWarn(ChangeType type, std::initializer_list<std::string> text = {},
+		std::initializer_list<int64_t> numbers = {});
+	void addSourceFile(const SourceFilePtr & sourceFile);
+	void addResourceFile(const SourceFilePtr & sourceFile);
+	std::vector<std::string> expandGlob(const std::string & pattern);
 
 	void parseProjectName();
 	void parseSources();
@@ -82,9 +115,11 @@ private:
 	void parseDefines();
 	void parseAppDefines();
 	void parseImport();
+	void parseInclude();
 	void parseResources();
 	void parseResourcesDir();
 	void parseAppResources();
+	void parseResourceOptions();
 	void parseWinRT();
 	void parseTizen();
 	void parseIOSorOSX();
@@ -99,8 +134,11 @@ private:
 	void parsePlatformOrBuildTypeMask(Platform::Type & platforms, BuildType::Value & buildTypes);
 	void parseFileFlags(const SourceFilePtr & sourceFile,
 		const SourceFilePtr & sourceFile2 = SourceFilePtr(), bool isPublicHeader = false);
+	void parseFileFlags(const std::vector<SourceFilePtr> & sourceFiles,
+		const SourceFilePtr & sourceFile2 = SourceFilePtr());
 
 	Token getToken();
+	void ungetToken();
 
 	int getChar();
 	void ungetChar();
@@ -0,0 +1,785 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "project_snapshot.h"
+#include "../config.h"
+#include "../util/cxx-util/cxx-util/fmt.h"
+#include "../util/cxx-util/cxx-util/trim.h"
+#include "../util/path-util/path-util.h"
+#include "../util/content_hash.h"
+#include "../util/file_stat.h"
+#include "../util/stat_cache.h"
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include <cstdio>
+#include <ctime>
+#include <cassert>
+
+#define SNAPSHOT_FILE_NAME "project.snapshot"
+#define SNAPSHOT_MAGIC "yip-project-snapshot"
+#define SNAPSHOT_VERSION 4
+
+// Modification times this close to the time of saving could change again without being noticed
+#define SNAPSHOT_RACY_TIME_NS 2000000000LL
+
+// Reads the whole file into memory
+static bool readFile(const std::string & path, std::string & data)
+{
+	FILE * f = fopen(path.c_str(), "rb");
+	if (!f)
+		return false;
+
+	char buf[65536];
+	data.clear();
+	for (;;)
+	{
+		size_t bytesRead = fread(buf, 1, sizeof(buf), f);
+		if (ferror(f))
+		{
+			fclose(f);
+			return false;
+		}
+		if (bytesRead == 0)
+			break;
+		data.append(buf, bytesRead);
+	}
+
+	fclose(f);
+	return true;
+}
+
+// Returns ID of the commit checked out in the specified git repository (empty string on failure)
+static std::string gitHeadId(const std::string & repoPath)
+{
+	std::string gitDir = pathConcat(repoPath, ".git");
+	std::string head;
+	if (!readFile(pathConcat(gitDir, "HEAD"), head))
+		return std::string();
+	head = trim(head);
+
+	if (head.compare(0, 4, "ref:") != 0)
+		return head;
+	std::string ref = trim(head.substr(4));
+
+	std::string id;
+	if (readFile(pathConcat(gitDir, ref), id))
+		return trim(id);
+
+	std::string packedRefs;
+	if (!readFile(pathConcat(gitDir, "packed-refs"), packedRefs))
+		return std::string();
+
+	size_t lineStart = 0;
+	while (lineStart < packedRefs.length())
+	{
+		size_t lineEnd = packedRefs.find('\n', lineStart);
+		if (lineEnd == std::string::npos)
+			lineEnd = packedRefs.length();
+
+		std::string line = trim(packedRefs.substr(lineStart, lineEnd - lineStart));
+		size_t space = line.find(' ');
+		if (space != std::string::npos && line.substr(space + 1) == ref)
+			return line.substr(0, space);
+
+		lineStart = lineEnd + 1;
+	}
+
+	return std::string();
+}
+
+static void writeStringSet(BinaryWriter & writer, const std::set<std::string> & set)
+{
+	writer.writeUInt32(static_cast<uint32_t>(set.size()));
+	for (const std::string & str : set)
+		writer.writeString(str);
+}
+
+static std::set<std::string> readStringSet(BinaryReader & reader)
+{
+	std::set<std::string> set;
+	for (uint32_t n = reader.readUInt32(); n > 0; n--)
+		set.insert(reader.readString());
+	return set;
+}
+
+static void writeStringVector(BinaryWriter & writer, const std::vector<std::string> & vector)
+{
+	writer.writeUInt32(static_cast<uint32_t>(vector.size()));
+	for (const std::string & str : vector)
+		writer.writeString(str);
+}
+
+static std::vector<std::string> readStringVector(BinaryReader & reader)
+{
+	std::vector<std::string> vector;
+	for (uint32_t n = reader.readUInt32(); n > 0; n--)
+		vector.push_back(reader.readString());
+	return vector;
+}
+
+static void writeStringMap(BinaryWriter & writer, const std::map<std::string, std::string> & map)
+{
+	writer.writeUInt32(static_cast<uint32_t>(map.size()));
+	for (const auto & it : map)
+	{
+		writer.writeString(it.first);
+		writer.writeString(it.second);
+	}
+}
+
+static std::map<std::string, std::string> readStringMap(BinaryReader & reader)
+{
+	std::map<std::string, std::string> map;
+	for (uint32_t n = reader.readUInt32(); n > 0; n--)
+	{
+		std::string key = reader.readString();
+		map[key] = reader.readString();
+	}
+	return map;
+}
+
+static void writeImageMap(BinaryWriter & writer, const std::map<Project::ImageSize, std::string> & map)
+{
+	writer.writeUInt32(static_cast<uint32_t>(map.size()));
+	for (const auto & it : map)
+	{
+		writer.writeUInt32(static_cast<uint32_t>(it.first));
+		writer.writeString(it.second);
+	}
+}
+
+static std::map<Project::ImageSize, std::string> readImageMap(BinaryReader & reader)
+{
+	std::map<Project::ImageSize, std::string> map;
+	for (uint32_t n = reader.readUInt32(); n > 0; n--)
+	{
+		Project::ImageSize size = static_cast<Project::ImageSize>(reader.readUInt32());
+		map[size] = reader.readString();
+	}
+	return map;
+}
+
+// Source files could be shared between several containers of the project, so they are stored in a table
+// and referenced by index
+class SourceFileTable
+{
+public:
+	void add(const SourceFilePtr & file)
+	{
+		if (file && m_Indices.insert(std::make_pair(file.get(), m_Files.size())).second)
+			m_Files.push_back(file);
+	}
+
+	void write(BinaryWriter & writer) const
+	{
+		writer.writeUInt32(static_cast<uint32_t>(m_Files.size()));
+		for (const SourceFilePtr & file : m_Files)
+			ProjectSnapshot::writeSourceFile(writer, *file);
+	}
+
+	void read(BinaryReader & reader)
+	{
+		for (uint32_t n = reader.readUInt32(); n > 0; n--)
+			m_Files.push_back(ProjectSnapshot::readSourceFile(reader));
+	}
+
+	void writeRef(BinaryWriter & writer, const SourceFilePtr & file) const
+	{
+		if (!file)
+		{
+			writer.writeUInt32(0);
+			return;
+		}
+		auto it = m_Indices.find(file.get());
+		assert(it != m_Indices.end());
+		writer.writeUInt32(static_cast<uint32_t>(it->second + 1));
+	}
+
+	SourceFilePtr readRef(BinaryReader & reader) const
+	{
+		uint32_t index = reader.readUInt32();
+		if (index == 0)
+			return SourceFilePtr();
+		if (index > m_Files.size())
+			throw std::runtime_error("invalid source file reference.");
+		return m_Files[index - 1];
+	}
+
+	void writeMap(BinaryWriter & writer, const std::map<std::string, SourceFilePtr> & map) const
+	{
+		writer.writeUInt32(static_cast<uint32_t>(map.size()));
+		for (const auto & it : map)
+		{
+			writer.writeString(it.first);
+			writeRef(writer, it.second);
+		}
+	}
+
+	std::map<std::string, SourceFilePtr> readMap(BinaryReader & reader) const
+	{
+		std::map<std::string, SourceFilePtr> map;
+		for (uint32_t n = reader.readUInt32(); n > 0; n--)
+		{
+			std::string key = reader.readString();
+			map[key] = readRef(reader);
+		}
+		return map;
+	}
+
+private:
+	std::vector<SourceFilePtr> m_Files;
+	std::unordered_map<const SourceFile *, size_t> m_Indices;
+};
+
+// Returns all files the parsed project depends on
+static std::set<std::string> projectDependencies(const ProjectPtr & project)
+{
+	std::set<std::string> files = project->projectFiles();
+	for (const auto & it : project->osxIcons())
+		files.insert(it.second);
+	for (const auto & it : project->iosIcons())
+		files.insert(it.second);
+	for (const auto & it : project->iosLaunchImages())
+		files.insert(it.second);
+	for (const auto & it : project->androidIcons())
+		files.insert(it.second);
+	return files;
+}
+
+bool ProjectSnapshot::load(const ProjectPtr & project, const std::string & settings)
+{
+	std::string data;
+	if (!readFile(pathConcat(project->yipDirectory()->path(), SNAPSHOT_FILE_NAME), data))
+		return false;
+
+	bool outdated = false;
+	std::string payload;
+	try
+	{
+		BinaryReader reader(data);
+		if (reader.readString() != SNAPSHOT_MAGIC || reader.readUInt32() != SNAPSHOT_VERSION)
+			return false;
+		if (reader.readString() != key(project, settings))
+			return false;
+
+		std::string fragmentsHash = reader.readString();
+		std::string fragments = reader.readString();
+		std::string hash = reader.readString();
+		payload = reader.readString();
+		if (!reader.atEnd() || contentHash(fragments) != fragmentsHash || contentHash(payload) != hash)
+			return false;
+
+		// Parse results of individual project files are reused even if the project has to be parsed again
+		BinaryReader fragmentsReader(fragments);
+		std::map<std::string, std::string> cachedFragments = readStringMap(fragmentsReader);
+		project->m_CachedFragments.swap(cachedFragments);
+	}
+	catch (const std::exception & e)
+	{
+		std::cerr << "warning: unable to load project snapshot: " << e.what() << std::endl;
+		return false;
+	}
+
+	// Snapshot of the project that has failed to parse contains only parse results of the project files
+	if (payload.empty())
+		return false;
+
+	// Project is modified only after all dependencies have been checked. Payload has been verified to be intact,
+	// so errors while reading it are reported in the same way as errors of the project file parser.
+	BinaryReader payloadReader(payload);
+	if (!checkDependencies(payloadReader, project, outdated))
+		return false;
+	readProject(payloadReader, *project);
+
+	// Project files have not been parsed, so their previous parse results are kept
+	project->m_ParsedFragments = project->m_CachedFragments;
+
+	// Wrappers for public headers of imported projects are written by the parser. Write them again, so that
+	// missing ones are restored and the rest are not collected as garbage.
+	for (const auto & it : project->includeWrappers())
+		project->yipDirectory()->writeIncludeWrapper(it.first, it.second);
+
+	// Modification times of some files have changed while their contents did not
+	if (outdated)
+	{
+		for (const std::string & file : project->projectFiles())
+		{
+			time_t modificationTime = cachedPathGetModificationTime(file);
+			if (modificationTime > project->m_ModificationTime)
+				project->m_ModificationTime = modificationTime;
+		}
+		save(project, settings);
+	}
+
+	return true;
+}
+
+void ProjectSnapshot::save(const ProjectPtr & project, const std::string & settings)
+{
+	try
+	{
+		BinaryWriter fragments;
+		writeStringMap(fragments, project->m_ParsedFragments);
+
+		BinaryWriter payload;
+		if (project->isValid())
+		{
+			writeDependencies(payload, project);
+			writeProject(payload, *project);
+		}
+
+		BinaryWriter writer;
+		writer.writeString(SNAPSHOT_MAGIC);
+		writer.writeUInt32(SNAPSHOT_VERSION);
+		writer.writeString(key(project, settings));
+		writer.writeString(contentHash(fragments.data()));
+		writer.writeString(fragments.data());
+		writer.writeString(contentHash(payload.data()));
+		writer.writeString(payload.data());
+
+		project->yipDirectory()->writeFile(SNAPSHOT_FILE_NAME, writer.data());
+	}
+	catch (const std::exception & e)
+	{
+		std::cerr << "warning: unable to save project snapshot: " << e.what() << std::endl;
+	}
+}
+
+std::string ProjectSnapshot::key(const ProjectPtr & project, const std::string & settings)
+{
+	std::stringstream ss;
+	ss << settings << '\n';
+	ss << project->yipDirectory()->generatorHash() << '\n';
+	ss << project->projectPath() << '\n';
+	ss << g_Config->projectFileName << '\n';
+	for (const auto & it : g_Config->repos)
+		ss << it.first << '=' << it.second << '\n';
+	return ss.str();
+}
+
+void ProjectSnapshot::writeDependencies(BinaryWriter & writer, const ProjectPtr & project)
+{
+	writeFileDependencies(writer, project->yipDirectory(), projectDependencies(project),
+		project->scannedDirectories());
+
+	const std::set<std::string> & imports = project->imports();
+	writer.writeUInt32(static_cast<uint32_t>(imports.size()));
+	for (const std::string & url : imports)
+	{
+		writer.writeString(url);
+		writer.writeString(gitHeadId(project->yipDirectory()->getGitRepositoryPath(url)));
+	}
+}
+
+bool ProjectSnapshot::checkDependencies(BinaryReader & reader, const ProjectPtr & project, bool & outdated)
+{
+	if (!checkFileDependencies(reader, project->yipDirectory(), outdated))
+		return false;
+
+	for (uint32_t n = reader.readUInt32(); n > 0; n--)
+	{
+		std::string url = reader.readString();
+		std::string headId = reader.readString();
+		if (headId.empty() || gitHeadId(project->yipDirectory()->getGitRepositoryPath(url)) != headId)
+			return false;
+	}
+
+	return true;
+}
+
+void ProjectSnapshot::writeFileDependencies(BinaryWriter & writer, const YipDirectoryPtr & yipDirectory,
+	const std::set<std::string> & files, const std::set<std::string> & dirs)
+{
+	long long racyTime = static_cast<long long>(time(nullptr)) * 1000000000LL - SNAPSHOT_RACY_TIME_NS;
+
+	writer.writeUInt32(static_cast<uint32_t>(files.size()));
+	for (const std::string & file : files)
+	{
+		FileStat st;
+		if (!fileStat(file, st))
+			throw std::runtime_error(fmt() << "unable to stat file '" << file << "'.");
+
+		// File modified just now could be modified again within the same tick; force a content check
+		writer.writeString(file);
+		writer.writeUInt64(st.size);
+		writer.writeInt64(st.modificationTimeNs < racyTime ? st.modificationTimeNs : -1);
+		writer.writeString(yipDirectory->fileSHA1(file));
+	}
+
+	writer.writeUInt32(static_cast<uint32_t>(dirs.size()));
+	for (const std::string & dir : dirs)
+	{
+		FileStat st;
+		if (!fileStat(dir, st))
+			throw std::runtime_error(fmt() << "unable to stat directory '" << dir << "'.");
+
+		writer.writeString(dir);
+		writer.writeInt64(st.modificationTimeNs < racyTime ? st.modificationTimeNs : -1);
+	}
+}
+
+bool ProjectSnapshot::checkFileDependencies(BinaryReader & reader, const YipDirectoryPtr & yipDirectory,
+	bool & outdated)
+{
+	for (uint32_t n = reader.readUInt32(); n > 0; n--)
+	{
+		std::string file = reader.readString();
+		uint64_t size = reader.readUInt64();
+		int64_t modificationTimeNs = reader.readInt64();
+		std::string sha1 = reader.readString();
+
+		FileStat st;
+		if (!fileStat(file, st) || st.size != size)
+			return false;
+		if (st.modificationTimeNs != modificationTimeNs)
+		{
+			if (yipDirectory->fileSHA1(file) != sha1)
+				return false;
+			outdated = true;
+		}
+	}
+
+	for (uint32_t n = reader.readUInt32(); n > 0; n--)
+	{
+		std::string dir = reader.readString();
+		int64_t modificationTimeNs = reader.readInt64();
+
+		FileStat st;
+		if (!fileStat(dir, st) || st.modificationTimeNs != modificationTimeNs)
+			return false;
+	}
+
+	return true;
+}
+
+void ProjectSnapshot::writeSourceFile(BinaryWriter & writer, const SourceFile & file)
+{
+	writer.writeString(file.name());
+	writer.writeString(file.path());
+	writer.writeUInt32(static_cast<uint32_t>(file.type()));
+	writer.writeUInt32(static_cast<uint32_t>(file.platforms()));
+	writer.writeUInt32(static_cast<uint32_t>(file.compression()));
+	writer.writeBool(file.isArcEnabled());
+	writer.writeBool(file.isGenerated());
+}
+
+SourceFilePtr ProjectSnapshot::readSourceFile(BinaryReader & reader)
+{
+	std::string name = reader.readString();
+	std::string path = reader.readString();
+	SourceFilePtr file = std::make_shared<SourceFile>(name, path);
+	file->setFileType(static_cast<FileType>(reader.readUInt32()));
+	file->setPlatforms(static_cast<Platform::Type>(reader.readUInt32()));
+	file->setCompression(static_cast<ResourceCompression>(reader.readUInt32()));
+	file->setArcEnabled(reader.readBool());
+	file->setIsGenerated(reader.readBool());
+	return file;
+}
+
+void ProjectSnapshot::writeProject(BinaryWriter & writer, const Project & project)
+{
+	SourceFileTable sourceFiles;
+	for (const auto & it : project.m_SourceFiles)
+		sourceFiles.add(it.second);
+	for (const auto & it : project.m_ResourceFiles)
+		sourceFiles.add(it.second);
+	for (const auto & it : project.m_UILayoutFiles)
+		sourceFiles.add(it.second);
+	for (const Project::IOSViewController & cntrl : project.m_IOSViewControllers)
+	{
+		sourceFiles.add(cntrl.ipad);
+		sourceFiles.add(cntrl.iphone);
+	}
+	for (const Project::AndroidView & view : project.m_AndroidViews)
+	{
+		sourceFiles.add(view.phone);
+		sourceFiles.add(view.tablet7);
+		sourceFiles.add(view.tablet10);
+	}
+	sourceFiles.write(writer);
+
+	writer.writeString(project.m_ProjectName);
+	writer.writeInt64(static_cast<int64_t>(project.m_ModificationTime));
+	writer.writeBool(project.m_HasModificationTime);
+	writeStringSet(writer, project.m_ProjectFiles);
+	writeStringSet(writer, project.m_ScannedDirectories);
+	writeStringMap(writer, project.m_IncludeWrappers);
+
+	writer.writeUInt32(static_cast<uint32_t>(project.m_ToDo.size()));
+	for (const Project::ToDo & todo : project.m_ToDo)
+	{
+		writer.writeString(todo.file);
+		writer.writeInt64(todo.line);
+		writer.writeString(todo.message);
+		writer.writeInt64(todo.year);
+		writer.writeInt64(todo.month);
+		writer.writeInt64(todo.day);
+	}
+
+	writer.writeUInt32(static_cast<uint32_t>(project.m_UILayoutFiles.size()));
+	for (const auto & it : project.m_UILayoutFiles)
+	{
+		writer.writeString(it.first);
+		sourceFiles.writeRef(writer, it.second);
+	}
+
+	writer.writeUInt32(static_cast<uint32_t>(project.m_TranslationFiles.size()));
+	for (const auto & it : project.m_TranslationFiles)
+	{
+		writer.writeString(it.second->language());
+		writer.writeString(it.second->name());
+		writer.writeString(it.second->path());
+	}
+	writeStringSet(writer, project.m_TranslationProjectFiles);
+
+	writer.writeUInt32(static_cast<uint32_t>(project.m_HeaderPaths.size()));
+	for (const auto & it : project.m_HeaderPaths)
+	{
+		writer.writeString(it.second->path());
+		writer.writeUInt32(static_cast<uint32_t>(it.second->platforms()));
+	}
+
+	sourceFiles.writeMap(writer, project.m_SourceFiles);
+	sourceFiles.writeMap(writer, project.m_ResourceFiles);
+
+	writer.writeUInt32(static_cast<uint32_t>(project.m_ResourceOptions.size()));
+	for (const auto & it : project.m_ResourceOptions)
+	{
+		writer.writeUInt32(static_cast<uint32_t>(it.first));
+		writer.writeUInt32(static_cast<uint32_t>(it.second.embedding));
+		writer.writeUInt64(it.second.shardSize);
+		writer.writeBool(it.second.hotReload);
+	}
+
+	writer.writeUInt32(static_cast<uint32_t>(project.m_Defines.size()));
+	for (const auto & it : project.m_Defines)
+	{
+		writer.writeString(it.second->name());
+		writer.writeUInt32(static_cast<uint32_t>(it.second->platforms()));
+		writer.writeUInt32(static_cast<uint32_t>(it.second->buildTypes()));
+	}
+
+	writeStringSet(writer, project.m_Imports);
+	writeStringMap(writer, project.m_OSXFrameworks);
+	writeStringMap(writer, project.m_IOSFrameworks);
+	writeImageMap(writer, project.m_OSXIcons);
+
+	writer.writeUInt32(static_cast<uint32_t>(project.m_IOSViewControllers.size()));
+	for (const Project::IOSViewController & cntrl : project.m_IOSViewControllers)
+	{
+		writer.writeString(cntrl.name);
+		writer.writeString(cntrl.parentClass);
+		sourceFiles.writeRef(writer, cntrl.ipad);
+		sourceFiles.writeRef(writer, cntrl.iphone);
+		writer.writeString(cntrl.projectFile);
+	}
+
+	writeImageMap(writer, project.m_IOSIcons);
+	writeImageMap(writer, project.m_IOSLaunchImages);
+	writeStringSet(writer, project.m_IOSFonts);
+	writeStringSet(writer, project.m_WinRTLibraries);
+	writeStringSet(writer, project.m_TizenPrivileges);
+	writeStringVector(writer, project.m_Licenses);
+
+	writer.writeString(project.m_OSXBundleIdentifier);
+	writer.writeString(project.m_OSXBundleVersion);
+	writer.writeString(project.m_OSXDeploymentTarget);
+	writer.writeString(project.m_IOSBundleIdentifier);
+	writer.writeString(project.m_IOSBundleVersion);
+	writer.writeString(project.m_IOSBundleDisplayName);
+	writer.writeString(project.m_IOSFacebookAppID);
+	writer.writeString(project.m_IOSFacebookDisplayName);
+	writer.writeString(project.m_IOSVkAppID);
+	writer.writeString(project.m_IOSDeploymentTarget);
+	writer.writeString(project.m_AndroidTarget);
+	writer.writeString(project.m_AndroidPackage);
+	writer.writeString(project.m_AndroidDisplayName);
+	writer.writeString(project.m_AndroidGlEsVersion);
+
+	writeStringMap(writer, project.m_AndroidMakeActivities);
+	writeStringSet(writer, project.m_AndroidJavaSourceDirs);
+
+	writer.writeUInt32(static_cast<uint32_t>(project.m_AndroidViews.size()));
+	for (const Project::AndroidView & view : project.m_AndroidViews)
+	{
+		writer.writeString(view.name);
+		sourceFiles.writeRef(writer, view.phone);
+		sourceFiles.writeRef(writer, view.tablet7);
+		sourceFiles.writeRef(writer, view.tablet10);
+	}
+
+	writeStringSet(writer, project.m_AndroidNativeLibs);
+	writeImageMap(writer, project.m_AndroidIcons);
+	writer.writeInt64(project.m_AndroidMinSdkVersion);
+	writer.writeInt64(project.m_AndroidTargetSdkVersion);
+	writeStringVector(writer, project.m_AndroidManifestActivities);
+
+	writer.writeBool(project.m_ShouldImportIOSUtil);
+	writer.writeBool(project.m_ShouldImportAndroidUtil);
+	writer.writeBool(project.m_IOSAllowIPad);
+	writer.writeBool(project.m_IOSAllowIPhone);
+}
+
+void ProjectSnapshot::readProject(BinaryReader & reader, Project & project)
+{
+	SourceFileTable sourceFiles;
+	sourceFiles.read(reader);
+
+	project.m_ProjectName = reader.readString();
+	project.m_ModificationTime = static_cast<time_t>(reader.readInt64());
+	project.m_HasModificationTime = reader.readBool();
+	project.m_ProjectFiles = readStringSet(reader);
+	project.m_ScannedDirectories = readStringSet(reader);
+	project.m_IncludeWrappers = readStringMap(reader);
+
+	project.m_ToDo.clear();
+	for (uint32_t n = reader.readUInt32(); n > 0; n--)
+	{
+		std::string file = reader.readString();
+		int line = static_cast<int>(reader.readInt64());
+		std::string message = reader.readString();
+		int year = static_cast<int>(reader.readInt64());
+		int month = static_cast<int>(reader.readInt64());
+		int day = static_cast<int>(reader.readInt64());
+		project.m_ToDo.push_back(Project::ToDo(file, line, message, year, month, day));
+	}
+
+	project.m_UILayoutFiles.clear();
+	for (uint32_t n = reader.readUInt32(); n > 0; n--)
+	{
+		std::string path = reader.readString();
+		project.m_UILayoutFiles[path] = sourceFiles.readRef(reader);
+	}
+
+	project.m_TranslationFiles.clear();
+	for (uint32_t n = reader.readUInt32(); n > 0; n--)
+	{
+		std::string language = reader.readString();
+		std::string name = reader.readString();
+		std::string path = reader.readString();
+		project.addTranslationFile(language, name, path);
+	}
+	project.m_TranslationProjectFiles = readStringSet(reader);
+
+	project.m_HeaderPaths.clear();
+	for (uint32_t n = reader.readUInt32(); n > 0; n--)
+	{
+		HeaderPathPtr headerPath = std::make_shared<HeaderPath>(reader.readString());
+		headerPath->setPlatforms(static_cast<Platform::Type>(reader.readUInt32()));
+		project.m_HeaderPaths[headerPath->path()] = headerPath;
+	}
+
+	project.m_SourceFiles = sourceFiles.readMap(reader);
+	project.m_ResourceFiles = sourceFiles.readMap(reader);
+
+	project.m_ResourceOptions.clear();
+	for (uint32_t n = reader.readUInt32(); n > 0; n--)
+	{
+		ResourceOptions & options = project.m_ResourceOptions[static_cast<Platform::Type>(reader.readUInt32())];
+		options.embedding = static_cast<ResourceEmbedding>(reader.readUInt32());
+		options.shardSize = static_cast<size_t>(reader.readUInt64());
+		options.hotReload = reader.readBool();
+	}
+
+	project.m_Defines.clear();
+	for (uint32_t n = reader.readUInt32(); n > 0; n--)
+	{
+		DefinePtr define = std::make_shared<Define>(reader.readString());
+		define->setPlatforms(static_cast<Platform::Type>(reader.readUInt32()));
+		define->setBuildTypes(static_cast<BuildType::Value>(reader.readUInt32()));
+		project.m_Defines[define->name()] = define;
+	}
+
+	project.m_Imports = readStringSet(reader);
+	project.m_OSXFrameworks = readStringMap(reader);
+	project.m_IOSFrameworks = readStringMap(reader);
+	project.m_OSXIcons = readImageMap(reader);
+
+	project.m_IOSViewControllers.clear();
+	project.m_IOSViewControllerNames.clear();
+	for (uint32_t n = reader.readUInt32(); n > 0; n--)
+	{
+		Project::IOSViewController cntrl;
+		cntrl.name = reader.readString();
+		cntrl.parentClass = reader.readString();
+		cntrl.ipad = sourceFiles.readRef(reader);
+		cntrl.iphone = sourceFiles.readRef(reader);
+		cntrl.projectFile = reader.readString();
+		project.m_IOSViewControllerNames.insert(cntrl.name);
+		project.m_IOSViewControllers.push_back(cntrl);
+	}
+
+	project.m_IOSIcons = readImageMap(reader);
+	project.m_IOSLaunchImages = readImageMap(reader);
+	project.m_IOSFonts = readStringSet(reader);
+	project.m_WinRTLibraries = readStringSet(reader);
+	project.m_TizenPrivileges = readStringSet(reader);
+	project.m_Licenses = readStringVector(reader);
+
+	project.m_OSXBundleIdentifier = reader.readString();
+	project.m_OSXBundleVersion = reader.readString();
+	project.m_OSXDeploymentTarget = reader.readString();
+	project.m_IOSBundleIdentifier = reader.readString();
+	project.m_IOSBundleVersion = reader.readString();
+	project.m_IOSBundleDisplayName = reader.readString();
+	project.m_IOSFacebookAppID = reader.readString();
+	project.m_IOSFacebookDisplayName = reader.readString();
+	project.m_IOSVkAppID = reader.readString();
+	project.m_IOSDeploymentTarget = reader.readString();
+	project.m_AndroidTarget = reader.readString();
+	project.m_AndroidPackage = reader.readString();
+	project.m_AndroidDisplayName = reader.readString();
+	project.m_AndroidGlEsVersion = reader.readString();
+
+	project.m_AndroidMakeActivities = readStringMap(reader);
+	project.m_AndroidJavaSourceDirs = readStringSet(reader);
+
+	project.m_AndroidViews.clear();
+	project.m_AndroidViewNames.clear();
+	for (uint32_t n = reader.readUInt32(); n > 0; n--)
+	{
+		Project::AndroidView view;
+		view.name = reader.readString();
+		view.phone = sourceFiles.readRef(reader);
+		view.tablet7 = sourceFiles.readRef(reader);
+		view.tablet10 = sourceFiles.readRef(reader);
+		project.m_AndroidViewNames.insert(view.name);
+		project.m_AndroidViews.push_back(view);
+	}
+
+	project.m_AndroidNativeLibs = readStringSet(reader);
+	project.m_AndroidIcons = readImageMap(reader);
+	project.m_AndroidMinSdkVersion = static_cast<int>(reader.readInt64());
+	project.m_AndroidTargetSdkVersion = static_cast<int>(reader.readInt64());
+	project.m_AndroidManifestActivities = readStringVector(reader);
+
+	project.m_ShouldImportIOSUtil = reader.readBool();
+	project.m_ShouldImportAndroidUtil = reader.readBool();
+	project.m_IOSAllowIPad = reader.readBool();
+	project.m_IOSAllowIPhone = reader.readBool();
+
+	if (!reader.atEnd())
+		throw std::runtime_error("unexpected data at the end of project snapshot.");
+}
@@ -0,0 +1,56 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __6e4f6c9b68534a77a0e2315375456d59__
+#define __6e4f6c9b68534a77a0e2315375456d59__
+
+#include "project.h"
+#include "../util/binary_stream.h"
+#include <string>
+#include <set>
+
+// Binary snapshot of the parsed project, stored in the .yip directory. Snapshot is used instead of parsing the
+// project files while the project files, images referenced by them, scanned directories and imported
+// repositories do not change. Otherwise only the project files that have changed are parsed again.
+class ProjectSnapshot
+{
+public:
+	// Settings should describe everything else the parsed project depends on
+	static bool load(const ProjectPtr & project, const std::string & settings);
+	static void save(const ProjectPtr & project, const std::string & settings);
+
+	// Used by the parser to store parse results of individual project files
+	static void writeFileDependencies(BinaryWriter & writer, const YipDirectoryPtr & yipDirectory,
+		const std::set<std::string> & files, const std::set<std::string> & dirs);
+	static bool checkFileDependencies(BinaryReader & reader, const YipDirectoryPtr & yipDirectory, bool & outdated);
+	static void writeSourceFile(BinaryWriter & writer, const SourceFile & file);
+	static SourceFilePtr readSourceFile(BinaryReader & reader);
+
+private:
+	static std::string key(const ProjectPtr & project, const std::string & settings);
+	static void writeDependencies(BinaryWriter & writer, const ProjectPtr & project);
+	static bool checkDependencies(BinaryReader & reader, const ProjectPtr & project, bool & outdated);
+	static void writeProject(BinaryWriter & writer, const Project & project);
+	static void readProject(BinaryReader & reader, Project & project);
+};
+
+#endif
@@ -21,62 +21,264 @@
 // THE SOFTWARE.
 //
 #include "resource_compiler.h"
+#include "resource_pack.h"
+#include "../config.h"
 #include "../util/path-util/path-util.h"
 #include "../util/cxx_escape.h"
 #include "../util/cxx-util/cxx-util/fmt.h"
+#include "../util/deflate.h"
 #include "../util/sha1.h"
+#include "../util/thread_pool.h"
+#include "../util/stat_cache.h"
+#include "../util/file_lock.h"
 #include <cstdio>
+#include <cstring>
+#include <vector>
 #include <stdexcept>
 #include <sstream>
-#include <unordered_map>
+#include <map>
+#include <algorithm>
+#include <set>
 #include <iomanip>
+#include <memory>
 
 #define SKIP_PLATFORMS (Platform::iOS | Platform::OSX | Platform::Android)
 
-typedef std::unordered_map<std::string, std::pair<std::string, Platform::Type>> ResCatalog;
+#define INPUT_CHUNK_SIZE 65536
+#define BYTES_PER_LINE 32
+#define HEX_BYTE_LENGTH 5
 
-static void makeResourceFile(ResCatalog & cat, const ProjectPtr & project, const SourceFilePtr & resourceFile)
+// Compressed resources are prefixed with the 64-bit little endian size of the uncompressed data
+#define COMPRESSED_HEADER_SIZE 8
+
+struct ResCatalogEntry
 {
-	std::string yipDir = project->yipDirectory()->path();
+	std::string targetName;
+	std::string sourcePath;
+	Platform::Type platforms;
+	ResourceCompression compression;
+};
 
-	std::string targetName = sha1(resourceFile->name());
-	std::string targetPath = pathConcat(".yip-resources", targetName) + ".cpp";
+// Catalog should be sorted by resource name to allow binary search at runtime
+typedef std::map<std::string, ResCatalogEntry> ResCatalog;
 
-	// Add file into the catalog
+struct ResOutput
+{
+	std::string name;
+	std::string path;
+	Platform::Type platforms;
+};
 
-	cat.insert(std::make_pair(resourceFile->name(), std::make_pair(targetName, resourceFile->platforms())));
+// Resource split into multiple source files
+struct ResShards
+{
+	Platform::Type platforms;
+	std::string name;
+	size_t count;
+};
 
-	// Do not regenerate output file if input file did not change
+struct ResBlob
+{
+	SourceFilePtr file;
+	Platform::Type platforms = 0;
+	std::vector<ResOutput> outputs;
+	std::vector<ResShards> shards;
+};
+
+// Embedded data, keyed by the target name
+typedef std::map<std::string, ResBlob> ResBlobs;
+
+class HexEncoder
+{
+public:
+	HexEncoder(const YipDirectory::WriteFunc & write);
+
+	inline size_t size() const { return m_Size; }
+
+	void write(const void * data, size_t size);
+
+private:
+	struct Table;
 
-	if (!project->yipDirectory()->shouldProcessFile(targetPath, resourceFile->path(), false))
+	YipDirectory::WriteFunc m_Write;
+	std::vector<char> m_Buffer;
+	size_t m_Size;
+
+	HexEncoder(const HexEncoder &) = delete;
+	HexEncoder & operator=(const HexEncoder &) = delete;
+};
+
+// Encoders run concurrently on the worker pool, so the table is a function-local static that is initialized
+// exactly once in a thread-safe manner
+struct HexEncoder::Table
+{
+	char bytes[256][HEX_BYTE_LENGTH];
+
+	Table()
 	{
-		SourceFilePtr sourceFile = project->addSourceFile(targetPath, pathConcat(yipDir, targetPath));
-		sourceFile->setIsGenerated(true);
-		sourceFile->setPlatforms(resourceFile->platforms() & ~SKIP_PLATFORMS);
-		return;
+		const char * hex = "0123456789abcdef";
+		for (int i = 0; i < 256; i++)
+		{
+			bytes[i][0] = '0';
+			bytes[i][1] = 'x';
+			bytes[i][2] = hex[i >> 4];
+			bytes[i][3] = hex[i & 0xF];
+			bytes[i][4] = ',';
+		}
+	}
+
+	static const Table & instance()
+	{
+		static const Table table;
+		return table;
 	}
+};
 
-	// Load the input file
+HexEncoder::HexEncoder(const YipDirectory::WriteFunc & write)
+	: m_Write(write),
+	  m_Buffer(INPUT_CHUNK_SIZE * HEX_BYTE_LENGTH + INPUT_CHUNK_SIZE / BYTES_PER_LINE + 1),
+	  m_Size(0)
+{
+}
 
+void HexEncoder::write(const void * data, size_t size)
+{
+	const Table & table = Table::instance();
+	const unsigned char * input = reinterpret_cast<const unsigned char *>(data);
+	while (size > 0)
+	{
+		size_t length = (size > INPUT_CHUNK_SIZE ? INPUT_CHUNK_SIZE : size);
+
+		char * p = m_Buffer.data();
+		for (size_t i = 0; i < length; i++)
+		{
+			if ((m_Size + i) % BYTES_PER_LINE == 0)
+				*p++ = '\n';
+			memcpy(p, table.bytes[input[i]], HEX_BYTE_LENGTH);
+			p += HEX_BYTE_LENGTH;
+		}
+
+		m_Write(m_Buffer.data(), static_cast<size_t>(p - m_Buffer.data()));
+
+		m_Size += length;
+		input += length;
+		size -= length;
+	}
+}
+
+static Platform::Type platformsWithEmbedding(const Project * project, Platform::Type platforms,
+	ResourceEmbedding embedding)
+{
+	Platform::Type result = 0;
+	for (Platform::Type platform = 1; platform < Platform::All; platform <<= 1)
+	{
+		if ((platforms & platform) && project->resourceOptions(platform).embedding == embedding)
+			result |= platform;
+	}
+	return result;
+}
+
+static Platform::Type platformsWithHotReload(const Project * project, Platform::Type platforms)
+{
+	Platform::Type result = 0;
+	for (Platform::Type platform = 1; platform < Platform::All; platform <<= 1)
+	{
+		if ((platforms & platform) && project->resourceOptions(platform).hotReload)
+			result |= platform;
+	}
+	return result;
+}
+
+static std::string compressionSuffix(ResourceCompression compression)
+{
+	switch (compression)
+	{
+	case RESOURCE_COMPRESS_NONE: return std::string();
+	case RESOURCE_COMPRESS_DEFLATE: return "_deflate";
+	case RESOURCE_COMPRESS_FAST: return "_fast";
+	}
+	return std::string();
+}
+
+static void asmEscape(std::ostream & ss, const std::string & str)
+{
+	for (char ch : str)
+	{
+		if (ch == '"' || ch == '\\')
+			ss << '\\';
+		ss << ch;
+	}
+}
+
+// Offsets of huge files do not fit into 'long' on LLP64 platforms, so fseek could not be used
+static bool seekFile(FILE * f, unsigned long long offset)
+{
+  #ifdef _WIN32
+	return _fseeki64(f, static_cast<__int64>(offset), SEEK_SET) == 0;
+  #else
+	return fseeko(f, static_cast<off_t>(offset), SEEK_SET) == 0;
+  #endif
+}
+
+static size_t fileSize(const std::string & path)
+{
+	FileStat st;
+	if (!cachedFileStat(path, st))
+		throw std::runtime_error(fmt() << "unable to determine size of file '" << path << "'.");
+
+	return static_cast<size_t>(st.size);
+}
+
+static void readResourceData(const SourceFilePtr & resourceFile, const YipDirectory::WriteFunc & write)
+{
 	FILE * f = fopen(resourceFile->path().c_str(), "rb");
 	if (!f)
 		throw std::runtime_error(fmt() << "unable to open file '" << resourceFile->path() << "'.");
 
-	std::vector<unsigned char> buf;
 	try
 	{
-		fseek(f, 0, SEEK_END);
-		long size = ftell(f);
-		fseek(f, 0, SEEK_SET);
+		std::unique_ptr<DeflateStream> deflater;
+		if (resourceFile->compression() != RESOURCE_COMPRESS_NONE)
+		{
+			fseek(f, 0, SEEK_END);
+			long size = ftell(f);
+			fseek(f, 0, SEEK_SET);
+
+			if (ferror(f) || size < 0)
+			{
+				throw std::runtime_error(fmt()
+					<< "unable to determine size of file '" << resourceFile->path() << "'.");
+			}
+
+			unsigned char header[COMPRESSED_HEADER_SIZE];
+			unsigned long long value = static_cast<unsigned long long>(size);
+			for (size_t i = 0; i < COMPRESSED_HEADER_SIZE; i++, value >>= 8)
+				header[i] = static_cast<unsigned char>(value & 0xFF);
+			write(header, sizeof(header));
+
+			if (resourceFile->compression() == RESOURCE_COMPRESS_FAST)
+				deflater.reset(new DeflateStream(write, Z_BEST_SPEED, true));
+			else
+				deflater.reset(new DeflateStream(write, Z_BEST_COMPRESSION, false));
+		}
+
+		std::vector<unsigned char> buf(INPUT_CHUNK_SIZE);
+		for (;;)
+		{
+			size_t bytesRead = fread(buf.data(), 1, buf.size(), f);
+			if (ferror(f))
+				throw std::runtime_error(fmt() << "unable to read file '" << resourceFile->path() << "'.");
+			if (bytesRead == 0)
+				break;
 
-		if (ferror(f) || size < 0)
-			throw std::runtime_error(fmt() << "unable to determine size of file '" << resourceFile->path() << "'.");
+			if (deflater)
+				deflater->write(buf.data(), bytesRead);
+			else
+				write(buf.data(), bytesRead);
+		}
 
-		buf.resize(static_cast<size_t>(size));
-		size_t bytesRead = fread(buf.data(), 1, static_cast<size_t>(size), f);
-		if (ferror(f))
-			throw std::runtime_error(fmt() << "unable to read file '" << resourceFile->path() << "'.");
-		buf.resize(bytesRead);
+		if (deflater)
+			deflater->finish();
 	}
 	catch (...)
 	{
@@ -85,86 +287,1323 @@ static void makeResourceFile(ResCatalog & cat, const ProjectPtr & project, const
 	}
 
 	fclose(f);
+}
 
-	// Generate the output file
+// Functions below are called from worker threads, so they should not modify the project
 
-	std::stringstream ss;
-	ss << "#include <cstddef>\n";
-	ss << "extern const size_t __yip_resource_size_" << targetName << " = " << buf.size() << ";\n";
-	ss << "extern const unsigned char __yip_resource_" << targetName << "[] = {";
-	size_t offset = 0;
-	for (unsigned char ch : buf)
+static ResOutput makeCxxResourceFile(const ProjectPtr & project, const SourceFilePtr & resourceFile,
+	const std::string & targetName, Platform::Type platforms)
+{
+	std::string yipDir = project->yipDirectory()->path();
+	std::string targetPath = pathConcat(".yip-resources", targetName) + ".cpp";
+
+	// Do not regenerate output file if input file did not change
+
+	if (!project->yipDirectory()->shouldProcessFile(targetPath, resourceFile->path(), false) ||
+			project->yipDirectory()->restoreCachedFile(targetPath, { resourceFile->path() },
+				fmt() << "compression=" << resourceFile->compression()))
+		return ResOutput{ targetPath, pathConcat(yipDir, targetPath), platforms };
+
+	// Generate the output file, reading input file in chunks
+
+	std::string generatedPath = project->yipDirectory()->writeFile(targetPath,
+		[&resourceFile, &targetName](const YipDirectory::WriteFunc & write) {
+			std::string header = "#ifndef YIP_RESOURCES_HOT_RELOAD\n"
+				"#include <cstddef>\n"
+				"extern const unsigned char __yip_resource_" + targetName + "[] = {";
+			write(header.data(), header.length());
+
+			HexEncoder encoder(write);
+			readResourceData(resourceFile, [&encoder](const void * data, size_t size) {
+				encoder.write(data, size);
+			});
+
+			// Empty arrays are not allowed in C++
+			std::stringstream ss;
+			if (encoder.size() == 0)
+				ss << "\n0x00,";
+			ss << "};\n";
+			ss << "extern const size_t __yip_resource_size_" << targetName << " = " << encoder.size() << ";\n";
+			ss << "#endif\n";
+
+			std::string footer = ss.str();
+			write(footer.data(), footer.length());
+		}
+	);
+
+	return ResOutput{ targetPath, generatedPath, platforms };
+}
+
+// Returns path to the file with data to embed. Compressed data is stored into a separate file.
+static std::string makeResourceBlob(const ProjectPtr & project, const SourceFilePtr & resourceFile,
+	const std::string & targetName)
+{
+	if (resourceFile->compression() == RESOURCE_COMPRESS_NONE)
+		return resourceFile->path();
+
+	std::string blobPath = pathConcat(".yip-resources", targetName) + ".z";
+	if (!project->yipDirectory()->shouldProcessFile(blobPath, resourceFile->path(), false) ||
+			project->yipDirectory()->restoreCachedFile(blobPath, { resourceFile->path() },
+				fmt() << "compression=" << resourceFile->compression()))
+		return pathConcat(project->yipDirectory()->path(), blobPath);
+
+	return project->yipDirectory()->writeFile(blobPath,
+		[&resourceFile](const YipDirectory::WriteFunc & write) {
+			readResourceData(resourceFile, write);
+		}
+	);
+}
+
+// Splits the data into multiple source files, so that they could be compiled in parallel
+static size_t makeShardedCxxResourceFiles(const ProjectPtr & project, const std::string & dataPath,
+	const std::string & shardsName, size_t shardSize, Platform::Type platforms, std::vector<ResOutput> & outputs)
+{
+	std::string yipDir = project->yipDirectory()->path();
+	size_t dataSize = fileSize(dataPath);
+	size_t count = (dataSize > 0 ? (dataSize + shardSize - 1) / shardSize : 1);
+
+	for (size_t i = 0; i < count; i++)
 	{
-		if (offset++ % 32 == 0)
-			ss << '\n';
-		ss << "0x" << std::hex << std::setw(2) << std::setfill('0') << static_cast<unsigned>(ch) << ',';
+		std::string name = fmt() << shardsName << '_' << i;
+		std::string targetPath = pathConcat(".yip-resources", name) + ".cpp";
+
+		if (!project->yipDirectory()->shouldProcessFile(targetPath, dataPath, false) ||
+			project->yipDirectory()->restoreCachedFile(targetPath, { dataPath }, fmt() << "shard_size=" << shardSize))
+		{
+			outputs.push_back(ResOutput{ targetPath, pathConcat(yipDir, targetPath), platforms });
+			continue;
+		}
+
+		std::string generatedPath = project->yipDirectory()->writeFile(targetPath,
+			[&dataPath, &name, shardSize, i](const YipDirectory::WriteFunc & write) {
+				std::string header = "#ifndef YIP_RESOURCES_HOT_RELOAD\n"
+					"#include <cstddef>\n"
+					"extern const unsigned char __yip_resource_" + name + "[] = {";
+				write(header.data(), header.length());
+
+				FILE * f = fopen(dataPath.c_str(), "rb");
+				if (!f)
+					throw std::runtime_error(fmt() << "unable to open file '" << dataPath << "'.");
+
+				HexEncoder encoder(write);
+				try
+				{
+					if (!seekFile(f, static_cast<unsigned long long>(i) * shardSize))
+						throw std::runtime_error(fmt() << "unable to seek in file '" << dataPath << "'.");
+
+					std::vector<unsigned char> buf(INPUT_CHUNK_SIZE);
+					for (size_t left = shardSize; left > 0; )
+					{
+						size_t bytesRead = fread(buf.data(), 1, std::min(left, buf.size()), f);
+						if (ferror(f))
+							throw std::runtime_error(fmt() << "unable to read file '" << dataPath << "'.");
+						if (bytesRead == 0)
+							break;
+						encoder.write(buf.data(), bytesRead);
+						left -= bytesRead;
+					}
+				}
+				catch (...)
+				{
+					fclose(f);
+					throw;
+				}
+				fclose(f);
+
+				// Empty arrays are not allowed in C++
+				std::stringstream ss;
+				if (encoder.size() == 0)
+					ss << "\n0x00,";
+				ss << "};\n";
+				ss << "extern const size_t __yip_resource_size_" << name << " = " << encoder.size() << ";\n";
+				ss << "#endif\n";
+
+				std::string footer = ss.str();
+				write(footer.data(), footer.length());
+			}
+		);
+
+		outputs.push_back(ResOutput{ targetPath, generatedPath, platforms });
 	}
-	ss << "};\n";
+
+	return count;
+}
+
+static ResOutput makeIncbinResourceFile(const ProjectPtr & project, const SourceFilePtr & resourceFile,
+	const std::string & dataPath, const std::string & targetName, Platform::Type platforms)
+{
+	std::string targetPath = pathConcat(".yip-resources", targetName) + ".S";
+	std::string data = "__yip_resource_" + targetName;
+	std::string size = "__yip_resource_size_" + targetName;
+
+	// Assembler stub is cheap to generate, so it is always regenerated. Modification time of the included file
+	// is written into the stub to force the build system to reassemble it when the included file changes.
+
+	std::stringstream ss;
+	ss << "/* " << resourceFile->name() << " (" << cachedPathGetModificationTime(dataPath) << ") */\n";
+	ss << '\n';
+	ss << "#ifndef YIP_RESOURCES_HOT_RELOAD\n";
+	ss << '\n';
+	ss << "#if defined(__APPLE__) || (defined(_WIN32) && !defined(_WIN64))\n";
+	ss << "#define YIP_SYMBOL(name) _##name\n";
+	ss << "#else\n";
+	ss << "#define YIP_SYMBOL(name) name\n";
+	ss << "#endif\n";
+	ss << '\n';
+	ss << "#if defined(__APPLE__)\n";
+	ss << "\t.const\n";
+	ss << "#elif defined(_WIN32)\n";
+	ss << "\t.section .rdata,\"dr\"\n";
+	ss << "#else\n";
+	ss << "\t.section .rodata\n";
+	ss << "#endif\n";
+	ss << '\n';
+	ss << "\t.globl YIP_SYMBOL(" << data << ")\n";
+	ss << "\t.balign 16\n";
+	ss << "YIP_SYMBOL(" << data << "):\n";
+	ss << "\t.incbin \"";
+	asmEscape(ss, pathMakeAbsolute(dataPath));
+	ss << "\"\n";
+	ss << "1:\n";
+	ss << "\t.byte 0\n";
+	ss << '\n';
+	ss << "\t.globl YIP_SYMBOL(" << size << ")\n";
+	ss << "\t.balign 8\n";
+	ss << "YIP_SYMBOL(" << size << "):\n";
+	ss << "#if __SIZEOF_POINTER__ == 8\n";
+	ss << "\t.quad 1b - YIP_SYMBOL(" << data << ")\n";
+	ss << "#else\n";
+	ss << "\t.long 1b - YIP_SYMBOL(" << data << ")\n";
+	ss << "#endif\n";
+	ss << '\n';
+	ss << "#if defined(__ELF__)\n";
+	ss << "\t.type " << data << ", %object\n";
+	ss << "\t.size " << data << ", 1b - " << data << "\n";
+	ss << "\t.type " << size << ", %object\n";
+	ss << "\t.size " << size << ", __SIZEOF_POINTER__\n";
+	ss << "#endif\n";
+	ss << '\n';
+	ss << "#endif\n";
+	ss << '\n';
+	ss << "#if defined(__ELF__)\n";
+	ss << "\t.section .note.GNU-stack,\"\",%progbits\n";
+	ss << "#endif\n";
 
 	// Write the output file
 
 	std::string generatedPath = project->yipDirectory()->writeFile(targetPath, ss.str());
-	SourceFilePtr sourceFile = project->addSourceFile(targetPath, generatedPath);
-	sourceFile->setIsGenerated(true);
-	sourceFile->setPlatforms(resourceFile->platforms() & ~SKIP_PLATFORMS);
+	return ResOutput{ targetPath, generatedPath, platforms };
 }
 
-void writeResourceCatalog(const ProjectPtr & project, const ResCatalog & cat, Platform::Type platform)
+static void makeResourceFile(const ProjectPtr & project, const std::string & targetName, ResBlob & blob)
 {
-	std::stringstream ss;
+	Platform::Type cxxPlatforms = platformsWithEmbedding(project.get(), blob.platforms, RESOURCE_EMBED_CXX);
+	Platform::Type incbinPlatforms = platformsWithEmbedding(project.get(), blob.platforms, RESOURCE_EMBED_INCBIN);
+
+	// Large resources are sharded on platforms that request it. Different platforms could use different
+	// shard sizes, so each shard size gets its own set of files.
+
+	size_t inputSize = fileSize(blob.file->path());
+	std::map<size_t, Platform::Type> shardedPlatforms;
+	for (Platform::Type platform = 1; platform < Platform::All; platform <<= 1)
+	{
+		size_t shardSize = project->resourceOptions(platform).shardSize;
+		if ((cxxPlatforms & platform) && shardSize != 0 && inputSize > shardSize)
+		{
+			shardedPlatforms[shardSize] |= platform;
+			cxxPlatforms &= ~platform;
+		}
+	}
+
+	if (cxxPlatforms != 0)
+		blob.outputs.push_back(makeCxxResourceFile(project, blob.file, targetName, cxxPlatforms));
+
+	if (incbinPlatforms == 0 && shardedPlatforms.empty())
+		return;
+
+	std::string dataPath = makeResourceBlob(project, blob.file, targetName);
+
+	if (incbinPlatforms != 0)
+		blob.outputs.push_back(makeIncbinResourceFile(project, blob.file, dataPath, targetName, incbinPlatforms));
+
+	for (auto it : shardedPlatforms)
+	{
+		ResShards shards;
+		shards.platforms = it.second;
+		shards.name = fmt() << targetName << '_' << it.first;
+		shards.count = makeShardedCxxResourceFiles(project, dataPath, shards.name, it.first, it.second,
+			blob.outputs);
+		blob.shards.push_back(shards);
+	}
+}
+
+static Platform::Type embeddedPlatforms(const ProjectPtr & project, const SourceFilePtr & resourceFile)
+{
+	Platform::Type platforms = resourceFile->platforms() & ~SKIP_PLATFORMS;
+	return platformsWithEmbedding(project.get(), platforms, RESOURCE_EMBED_CXX)
+		| platformsWithEmbedding(project.get(), platforms, RESOURCE_EMBED_INCBIN);
+}
 
+static void addResourceToCatalog(ResCatalog & cat, ResBlobs & blobs, const ProjectPtr & project,
+	const SourceFilePtr & resourceFile, const std::string & contentHash)
+{
+	Platform::Type embedPlatforms = embeddedPlatforms(project, resourceFile);
+
+	// Embedded data is keyed by contents of the file, so that identical files are compiled only once.
+	// Compression is part of the key because it affects the embedded data.
+
+	std::string targetName;
+	if (embedPlatforms != 0)
+	{
+		targetName = contentHash + compressionSuffix(resourceFile->compression());
+
+		auto r = blobs.insert(std::make_pair(targetName, ResBlob()));
+		if (r.second)
+			r.first->second.file = resourceFile;
+		r.first->second.platforms |= embedPlatforms;
+	}
+
+	ResCatalogEntry entry;
+	entry.targetName = targetName;
+	entry.sourcePath = pathMakeAbsolute(resourceFile->path());
+	entry.platforms = resourceFile->platforms();
+	entry.compression = resourceFile->compression();
+	cat.insert(std::make_pair(resourceFile->name(), entry));
+}
+
+static void writeCatalogIncludes(std::ostream & ss, bool hasCompressed, bool hasCache)
+{
+	ss << "#include \"../.yip-import-proxies/yip/resources.h\"\n";
+	ss << "#include <cstring>\n";
+	if (hasCache)
+	{
+		ss << "#include <cstdlib>\n";
+		ss << "#include <atomic>\n";
+	}
+	if (hasCompressed)
+	{
+		ss << "#ifdef YIP_ZLIB_HEADER\n";
+		ss << "#include YIP_ZLIB_HEADER\n";
+		ss << "#else\n";
+		ss << "#include <zlib.h>\n";
+		ss << "#endif\n";
+	}
+	ss << "#ifndef YIP_RESOURCES_NO_LEGACY_MAP\n";
 	ss << "#include <unordered_map>\n";
 	ss << "#include <string>\n";
+	ss << "#endif\n";
+}
+
+static void writeCatalogFoundStruct(std::ostream & ss, bool hasCache, bool hasSharded)
+{
+	ss << "\tstruct Found\n";
+	ss << "\t{\n";
+	ss << "\t\tconst unsigned char * data;\n";
+	ss << "\t\tsize_t size;\n";
+	ss << "\t\tint compression;\n";
+	if (hasCache)
+		ss << "\t\tstd::atomic<unsigned char *> * cache;\n";
+	if (hasSharded)
+	{
+		ss << "\t\tsize_t numParts;\n";
+		ss << "\t\tconst unsigned char * const * parts;\n";
+		ss << "\t\tconst size_t * const * partSizes;\n";
+	}
+	ss << "\t};\n";
+}
+
+// Data of the sharded resource is split into multiple parts. Other resources consist of a single part.
+static void writeCatalogDataFunctions(std::ostream & ss, bool hasCompressed, bool hasSharded)
+{
+	ss << '\n';
+	ss << "\tsize_t partCount(const Found & res)\n";
+	ss << "\t{\n";
+	if (!hasSharded)
+	{
+		ss << "\t\t(void)res;\n";
+		ss << "\t\treturn 1;\n";
+	}
+	else
+		ss << "\t\treturn (res.numParts > 0 ? res.numParts : 1);\n";
+	ss << "\t}\n";
+	ss << '\n';
+	ss << "\tconst unsigned char * partData(const Found & res, size_t index)\n";
+	ss << "\t{\n";
+	if (!hasSharded)
+	{
+		ss << "\t\t(void)index;\n";
+		ss << "\t\treturn res.data;\n";
+	}
+	else
+		ss << "\t\treturn (res.numParts > 0 ? res.parts[index] : res.data);\n";
+	ss << "\t}\n";
+	ss << '\n';
+	ss << "\tsize_t partSize(const Found & res, size_t index)\n";
+	ss << "\t{\n";
+	if (!hasSharded)
+	{
+		ss << "\t\t(void)index;\n";
+		ss << "\t\treturn res.size;\n";
+	}
+	else
+		ss << "\t\treturn (res.numParts > 0 ? *res.partSizes[index] : res.size);\n";
+	ss << "\t}\n";
+
+	// Shard size is never less than the size of the header, so the header is always in the first part
+
+	if (hasCompressed)
+	{
+		ss << '\n';
+		ss << "\tsize_t unpackedSize(const Found & res)\n";
+		ss << "\t{\n";
+		ss << "\t\tif (partSize(res, 0) < " << COMPRESSED_HEADER_SIZE << ")\n";
+		ss << "\t\t\treturn 0;\n";
+		ss << "\t\tconst unsigned char * data = partData(res, 0);\n";
+		ss << "\t\tunsigned long long size = 0;\n";
+		ss << "\t\tfor (int i = " << COMPRESSED_HEADER_SIZE - 1 << "; i >= 0; i--)\n";
+		ss << "\t\t\tsize = (size << 8) | data[i];\n";
+		ss << "\t\treturn static_cast<size_t>(size);\n";
+		ss << "\t}\n";
+		ss << '\n';
+		ss << "\tbool unpack(const Found & res, void * buffer, size_t size)\n";
+		ss << "\t{\n";
+		ss << "\t\tif (partSize(res, 0) < " << COMPRESSED_HEADER_SIZE << ")\n";
+		ss << "\t\t\treturn false;\n";
+		ss << "\t\tz_stream stream;\n";
+		ss << "\t\tmemset(&stream, 0, sizeof(stream));\n";
+		ss << "\t\tint windowBits = (res.compression == " << RESOURCE_COMPRESS_FAST
+			<< " ? -MAX_WBITS : MAX_WBITS);\n";
+		ss << "\t\tif (inflateInit2(&stream, windowBits) != Z_OK)\n";
+		ss << "\t\t\treturn false;\n";
+		ss << "\t\tstream.next_out = static_cast<Bytef *>(buffer);\n";
+		ss << "\t\tstream.avail_out = static_cast<uInt>(size);\n";
+		ss << "\t\tsize_t skip = " << COMPRESSED_HEADER_SIZE << ";\n";
+		ss << "\t\tint r = Z_OK;\n";
+		ss << "\t\tfor (size_t i = 0; i < partCount(res) && r == Z_OK; i++, skip = 0)\n";
+		ss << "\t\t{\n";
+		ss << "\t\t\tstream.next_in = const_cast<Bytef *>(partData(res, i) + skip);\n";
+		ss << "\t\t\tstream.avail_in = static_cast<uInt>(partSize(res, i) - skip);\n";
+		ss << "\t\t\twhile (r == Z_OK && stream.avail_in > 0)\n";
+		ss << "\t\t\t\tr = inflate(&stream, Z_NO_FLUSH);\n";
+		ss << "\t\t}\n";
+		ss << "\t\tinflateEnd(&stream);\n";
+		ss << "\t\treturn r == Z_STREAM_END && stream.total_out == size;\n";
+		ss << "\t}\n";
+	}
+
+	ss << '\n';
+	ss << "\tbool isContiguous(const Found & res)\n";
+	ss << "\t{\n";
+	if (hasSharded)
+		ss << "\t\treturn res.compression == " << RESOURCE_COMPRESS_NONE << " && res.numParts == 0;\n";
+	else
+		ss << "\t\treturn res.compression == " << RESOURCE_COMPRESS_NONE << ";\n";
+	ss << "\t}\n";
+	ss << '\n';
+	ss << "\tsize_t contentSize(const Found & res)\n";
+	ss << "\t{\n";
+	if (hasCompressed)
+		ss << "\t\treturn (res.compression != " << RESOURCE_COMPRESS_NONE << " ? unpackedSize(res) : res.size);\n";
+	else
+		ss << "\t\treturn res.size;\n";
+	ss << "\t}\n";
+	ss << '\n';
+	ss << "\tbool copyContent(const Found & res, void * buffer, size_t size)\n";
+	ss << "\t{\n";
+	if (hasCompressed)
+	{
+		ss << "\t\tif (res.compression != " << RESOURCE_COMPRESS_NONE << ")\n";
+		ss << "\t\t\treturn unpack(res, buffer, size);\n";
+	}
+	ss << "\t\tunsigned char * p = static_cast<unsigned char *>(buffer);\n";
+	ss << "\t\tfor (size_t i = 0; i < partCount(res); i++)\n";
+	ss << "\t\t{\n";
+	ss << "\t\t\tsize_t length = partSize(res, i);\n";
+	ss << "\t\t\tif (length > size)\n";
+	ss << "\t\t\t\treturn false;\n";
+	ss << "\t\t\tmemcpy(p, partData(res, i), length);\n";
+	ss << "\t\t\tp += length;\n";
+	ss << "\t\t\tsize -= length;\n";
+	ss << "\t\t}\n";
+	ss << "\t\treturn true;\n";
+	ss << "\t}\n";
+}
+
+static void writeCatalogAccessFunctions(std::ostream & ss, bool hasCache)
+{
+	ss << '\n';
+	ss << "bool YIP::findResource(const char * name, const void ** data, size_t * size)\n";
+	ss << "{\n";
+	ss << "\tFound res;\n";
+	ss << "\tif (!lookup(name, res))\n";
+	ss << "\t\treturn false;\n";
+	if (hasCache)
+	{
+		// Compressed and sharded resources are unpacked into contiguous memory on first access. Threads racing
+		// to unpack the same resource publish their buffers atomically, losers free their copy.
+
+		ss << '\n';
+		ss << "\tif (!isContiguous(res))\n";
+		ss << "\t{\n";
+		ss << "\t\tsize_t unpacked = contentSize(res);\n";
+		ss << "\t\tunsigned char * buffer = res.cache->load(std::memory_order_acquire);\n";
+		ss << "\t\tif (!buffer)\n";
+		ss << "\t\t{\n";
+		ss << "\t\t\tbuffer = static_cast<unsigned char *>(malloc(unpacked > 0 ? unpacked : 1));\n";
+		ss << "\t\t\tif (!buffer || !copyContent(res, buffer, unpacked))\n";
+		ss << "\t\t\t{\n";
+		ss << "\t\t\t\tfree(buffer);\n";
+		ss << "\t\t\t\treturn false;\n";
+		ss << "\t\t\t}\n";
+		ss << "\t\t\tunsigned char * expected = nullptr;\n";
+		ss << "\t\t\tif (!res.cache->compare_exchange_strong(expected, buffer, std::memory_order_acq_rel))\n";
+		ss << "\t\t\t{\n";
+		ss << "\t\t\t\tfree(buffer);\n";
+		ss << "\t\t\t\tbuffer = expected;\n";
+		ss << "\t\t\t}\n";
+		ss << "\t\t}\n";
+		ss << "\t\tif (data)\n";
+		ss << "\t\t\t*data = buffer;\n";
+		ss << "\t\tif (size)\n";
+		ss << "\t\t\t*size = unpacked;\n";
+		ss << "\t\treturn true;\n";
+		ss << "\t}\n";
+		ss << '\n';
+	}
+	ss << "\tif (data)\n";
+	ss << "\t\t*data = res.data;\n";
+	ss << "\tif (size)\n";
+	ss << "\t\t*size = res.size;\n";
+	ss << "\treturn true;\n";
+	ss << "}\n";
 
+	ss << '\n';
+	ss << "bool YIP::getResourceSize(const char * name, size_t * size)\n";
+	ss << "{\n";
+	ss << "\tFound res;\n";
+	ss << "\tif (!lookup(name, res))\n";
+	ss << "\t\treturn false;\n";
+	ss << "\tif (size)\n";
+	if (!hasCache)
+		ss << "\t\t*size = res.size;\n";
+	else
+		ss << "\t\t*size = contentSize(res);\n";
+	ss << "\treturn true;\n";
+	ss << "}\n";
+
+	ss << '\n';
+	ss << "bool YIP::readResource(const char * name, void * buffer, size_t bufferSize)\n";
+	ss << "{\n";
+	ss << "\tFound res;\n";
+	ss << "\tif (!lookup(name, res))\n";
+	ss << "\t\treturn false;\n";
+	if (hasCache)
+	{
+		ss << "\tif (!isContiguous(res))\n";
+		ss << "\t{\n";
+		ss << "\t\tsize_t unpacked = contentSize(res);\n";
+		ss << "\t\tif (bufferSize < unpacked)\n";
+		ss << "\t\t\treturn false;\n";
+		ss << "\t\tconst unsigned char * cached = res.cache->load(std::memory_order_acquire);\n";
+		ss << "\t\tif (!cached)\n";
+		ss << "\t\t\treturn copyContent(res, buffer, unpacked);\n";
+		ss << "\t\tmemcpy(buffer, cached, unpacked);\n";
+		ss << "\t\treturn true;\n";
+		ss << "\t}\n";
+	}
+	ss << "\tif (bufferSize < res.size)\n";
+	ss << "\t\treturn false;\n";
+	ss << "\tmemcpy(buffer, res.data, res.size);\n";
+	ss << "\treturn true;\n";
+	ss << "}\n";
+}
+
+// Functions enumerating the 'resources' table for the legacy map, which is their only user
+static void writeCatalogLegacyMapAccessors(std::ostream & ss)
+{
+	ss << '\n';
+	ss << "#ifndef YIP_RESOURCES_NO_LEGACY_MAP\n";
+	ss << "\tsize_t resourceCount()\n";
+	ss << "\t{\n";
+	ss << "\t\treturn numResources;\n";
+	ss << "\t}\n";
+	ss << '\n';
+	ss << "\tconst char * resourceName(size_t index)\n";
+	ss << "\t{\n";
+	ss << "\t\treturn resources[index].name;\n";
+	ss << "\t}\n";
+	ss << "#endif\n";
+}
+
+// Compatibility shim for the code that uses the map directly
+static void writeCatalogLegacyMap(std::ostream & ss)
+{
+	ss << '\n';
+	ss << "#ifndef YIP_RESOURCES_NO_LEGACY_MAP\n";
+	ss << "static std::unordered_map<std::string, std::pair<const void *, size_t>> makeLegacyMap()\n";
+	ss << "{\n";
+	ss << "\tstd::unordered_map<std::string, std::pair<const void *, size_t>> map;\n";
+	ss << "\tsize_t count = resourceCount();\n";
+	ss << "\tmap.reserve(count);\n";
+	ss << "\tfor (size_t i = 0; i < count; i++)\n";
+	ss << "\t{\n";
+	ss << "\t\tconst char * name = resourceName(i);\n";
+	ss << "\t\tconst void * data = nullptr;\n";
+	ss << "\t\tsize_t size = 0;\n";
+	ss << "\t\tif (YIP::findResource(name, &data, &size))\n";
+	ss << "\t\t\tmap.insert(std::make_pair(name, std::make_pair(data, size)));\n";
+	ss << "\t}\n";
+	ss << "\treturn map;\n";
+	ss << "}\n";
+	ss << '\n';
+	ss << "std::unordered_map<std::string, std::pair<const void *, size_t>> __yip_resources = makeLegacyMap();\n";
+	ss << "#endif\n";
+}
+
+static std::string catalogFileName(Platform::Type platform)
+{
+	return fmt() << ".yip-resources/catalog_" << std::hex << std::setw(4) << std::setfill('0') << platform << ".cpp";
+}
+
+static void addCatalogFile(const ProjectPtr & project, const std::string & name, const std::string & data,
+	Platform::Type platform)
+{
+	std::string generatedPath = project->yipDirectory()->writeFile(name, data);
+	SourceFilePtr sourceFile = project->addSourceFile(name, generatedPath);
+	sourceFile->setIsGenerated(true);
+	sourceFile->setPlatforms(platform);
+}
+
+static bool catalogHasCompressed(const ResCatalog & cat, Platform::Type platform)
+{
+	for (auto it : cat)
+	{
+		if ((it.second.platforms & platform) && it.second.compression != RESOURCE_COMPRESS_NONE)
+			return true;
+	}
+	return false;
+}
+
+static const ResShards * findShards(const ResBlobs & blobs, const ResCatalogEntry & entry, Platform::Type platform)
+{
+	auto it = blobs.find(entry.targetName);
+	if (it == blobs.end())
+		return nullptr;
+
+	for (const ResShards & shards : it->second.shards)
+	{
+		if (shards.platforms & platform)
+			return &shards;
+	}
+
+	return nullptr;
+}
+
+static void writeResourceCatalog(std::stringstream & ss, const ResCatalog & cat, const ResBlobs & blobs,
+	Platform::Type platform)
+{
+	bool hasCompressed = catalogHasCompressed(cat, platform);
+
+	size_t count = 0;
+	bool hasSharded = false;
+	for (auto it : cat)
+	{
+		if (it.second.platforms & platform)
+		{
+			++count;
+			if (findShards(blobs, it.second, platform))
+				hasSharded = true;
+		}
+	}
+
+	bool hasCache = (hasCompressed || hasSharded);
+	writeCatalogIncludes(ss, hasCompressed, hasCache);
+
+	// Resources with identical contents share a single symbol, so it is declared only once
+
+	std::set<std::string> declared;
 	for (auto it : cat)
 	{
-		if (it.second.second & platform)
+		if (!(it.second.platforms & platform) || !declared.insert(it.second.targetName).second)
+			continue;
+
+		const ResShards * shards = findShards(blobs, it.second, platform);
+		if (!shards)
 		{
 			ss << '\n';
-			ss << "extern const unsigned char __yip_resource_" << it.second.first << "[];\n";
-			ss << "extern const size_t __yip_resource_size_" << it.second.first << ";\n";
+			ss << "extern const unsigned char __yip_resource_" << it.second.targetName << "[];\n";
+			ss << "extern const size_t __yip_resource_size_" << it.second.targetName << ";\n";
+			continue;
+		}
+
+		ss << '\n';
+		for (size_t i = 0; i < shards->count; i++)
+		{
+			ss << "extern const unsigned char __yip_resource_" << shards->name << '_' << i << "[];\n";
+			ss << "extern const size_t __yip_resource_size_" << shards->name << '_' << i << ";\n";
 		}
+		ss << "static const unsigned char * const __yip_resource_parts_" << shards->name << "[] = {\n";
+		for (size_t i = 0; i < shards->count; i++)
+			ss << "\t__yip_resource_" << shards->name << '_' << i << ",\n";
+		ss << "};\n";
+		ss << "static const size_t * const __yip_resource_part_sizes_" << shards->name << "[] = {\n";
+		for (size_t i = 0; i < shards->count; i++)
+			ss << "\t&__yip_resource_size_" << shards->name << '_' << i << ",\n";
+		ss << "};\n";
 	}
 
+	// Table contains only address constants, so it is initialized statically without any code at startup
+
+	ss << '\n';
+	ss << "namespace\n";
+	ss << "{\n";
+	ss << "\tstruct Resource\n";
+	ss << "\t{\n";
+	ss << "\t\tconst char * name;\n";
+	ss << "\t\tconst unsigned char * data;\n";
+	ss << "\t\tconst size_t * size;\n";
+	ss << "\t\tint compression;\n";
+	if (hasSharded)
+	{
+		ss << "\t\tsize_t numParts;\n";
+		ss << "\t\tconst unsigned char * const * parts;\n";
+		ss << "\t\tconst size_t * const * partSizes;\n";
+	}
+	ss << "\t};\n";
+	ss << '\n';
+	writeCatalogFoundStruct(ss, hasCache, hasSharded);
 	ss << '\n';
-	ss << "std::unordered_map<std::string, std::pair<const void *, size_t>> __yip_resources = {\n";
+	ss << "\tconst size_t numResources = " << count << ";\n";
+	ss << "\tconst Resource resources[" << (count > 0 ? count : 1) << "] = {\n";
 
 	for (auto it : cat)
 	{
-		if (!(it.second.second & platform))
+		if (!(it.second.platforms & platform))
 			continue;
-		ss << "\t{ \"";
+
+		ss << "\t\t{ \"";
 		cxxEscape(ss, it.first);
-		ss << "\", { __yip_resource_" << it.second.first << ", __yip_resource_size_" << it.second.first << " } },\n";
+		ss << "\", ";
+
+		const ResShards * shards = findShards(blobs, it.second, platform);
+		if (shards)
+		{
+			ss << "nullptr, nullptr, " << it.second.compression << ", " << shards->count
+				<< ", __yip_resource_parts_" << shards->name << ", __yip_resource_part_sizes_" << shards->name;
+		}
+		else
+		{
+			ss << "__yip_resource_" << it.second.targetName << ", &__yip_resource_size_"
+				<< it.second.targetName << ", " << it.second.compression;
+			if (hasSharded)
+				ss << ", 0, nullptr, nullptr";
+		}
+
+		ss << " },\n";
 	}
+	if (count == 0)
+		ss << "\t\t{ nullptr, nullptr, nullptr, 0 },\n";
 
-	ss << "};\n";
+	ss << "\t};\n";
 
-	std::string name = fmt() << ".yip-resources/catalog_"
-		<< std::hex << std::setw(4) << std::setfill('0') << platform << ".cpp";
+	if (hasCache)
+	{
+		ss << '\n';
+		ss << "\tstd::atomic<unsigned char *> cache[" << count << "];\n";
+		writeCatalogDataFunctions(ss, hasCompressed, hasSharded);
+	}
 
-	std::string generatedPath = project->yipDirectory()->writeFile(name, ss.str());
-	SourceFilePtr sourceFile = project->addSourceFile(name, generatedPath);
+	ss << '\n';
+	ss << "\tbool lookup(const char * name, Found & found)\n";
+	ss << "\t{\n";
+	ss << "\t\tsize_t lo = 0, hi = numResources;\n";
+	ss << "\t\twhile (lo < hi)\n";
+	ss << "\t\t{\n";
+	ss << "\t\t\tsize_t mid = lo + (hi - lo) / 2;\n";
+	ss << "\t\t\tint r = strcmp(name, resources[mid].name);\n";
+	ss << "\t\t\tif (r < 0)\n";
+	ss << "\t\t\t\thi = mid;\n";
+	ss << "\t\t\telse if (r > 0)\n";
+	ss << "\t\t\t\tlo = mid + 1;\n";
+	ss << "\t\t\telse\n";
+	ss << "\t\t\t{\n";
+	ss << "\t\t\t\tconst Resource & res = resources[mid];\n";
+	ss << "\t\t\t\tfound.compression = res.compression;\n";
+	if (hasCache)
+		ss << "\t\t\t\tfound.cache = &cache[mid];\n";
+	if (hasSharded)
+	{
+		ss << "\t\t\t\tfound.numParts = res.numParts;\n";
+		ss << "\t\t\t\tfound.parts = res.parts;\n";
+		ss << "\t\t\t\tfound.partSizes = res.partSizes;\n";
+		ss << "\t\t\t\tif (res.numParts > 0)\n";
+		ss << "\t\t\t\t{\n";
+		ss << "\t\t\t\t\tfound.data = res.parts[0];\n";
+		ss << "\t\t\t\t\tfound.size = 0;\n";
+		ss << "\t\t\t\t\tfor (size_t i = 0; i < res.numParts; i++)\n";
+		ss << "\t\t\t\t\t\tfound.size += *res.partSizes[i];\n";
+		ss << "\t\t\t\t\treturn true;\n";
+		ss << "\t\t\t\t}\n";
+	}
+	ss << "\t\t\t\tfound.data = res.data;\n";
+	ss << "\t\t\t\tfound.size = *res.size;\n";
+	ss << "\t\t\t\treturn true;\n";
+	ss << "\t\t\t}\n";
+	ss << "\t\t}\n";
+	ss << "\t\treturn false;\n";
+	ss << "\t}\n";
+	writeCatalogLegacyMapAccessors(ss);
+	ss << "}\n";
+
+	ss << '\n';
+	ss << "void YIP::setResourcePackPath(const char *)\n";
+	ss << "{\n";
+	ss << "}\n";
+	ss << '\n';
+	ss << "void YIP::setResourceRoot(const char *)\n";
+	ss << "{\n";
+	ss << "}\n";
+
+	writeCatalogAccessFunctions(ss, hasCache);
+	writeCatalogLegacyMap(ss);
+}
+
+static void writePackCatalog(std::stringstream & ss, const ResCatalog & cat, Platform::Type platform,
+	const std::string & packName)
+{
+	bool hasCompressed = catalogHasCompressed(cat, platform);
+
+	writeCatalogIncludes(ss, hasCompressed, hasCompressed);
+	ss << "#include <mutex>\n";
+	ss << "#include <string>\n";
+	ss << "#ifdef _WIN32\n";
+	ss << "#define WIN32_LEAN_AND_MEAN\n";
+	ss << "#include <windows.h>\n";
+	ss << "#else\n";
+	ss << "#include <sys/mman.h>\n";
+	ss << "#include <sys/stat.h>\n";
+	ss << "#include <fcntl.h>\n";
+	ss << "#include <unistd.h>\n";
+	ss << "#endif\n";
+
+	// Contents of the pack are not known at compile time, so this file does not change when resources change
+
+	ss << '\n';
+	ss << "namespace\n";
+	ss << "{\n";
+	writeCatalogFoundStruct(ss, hasCompressed, false);
+	ss << '\n';
+	ss << "\tconst char * packPath;\n";
+	ss << "\tstd::once_flag packMounted;\n";
+	ss << "\tconst unsigned char * packData;\n";
+	ss << "\tsize_t packSize;\n";
+	ss << "\tconst unsigned char * packIndex;\n";
+	ss << "\tconst char * packNames;\n";
+	ss << "\tsize_t packNamesSize;\n";
+	ss << "\tsize_t numResources;\n";
+	if (hasCompressed)
+		ss << "\tstd::atomic<unsigned char *> * cache;\n";
+	ss << '\n';
+	ss << "\tunsigned long long readLE(const unsigned char * p, int size)\n";
+	ss << "\t{\n";
+	ss << "\t\tunsigned long long value = 0;\n";
+	ss << "\t\tfor (int i = size - 1; i >= 0; i--)\n";
+	ss << "\t\t\tvalue = (value << 8) | p[i];\n";
+	ss << "\t\treturn value;\n";
+	ss << "\t}\n";
+	ss << '\n';
+	// Path of the pack is not compiled in, so that the catalog does not depend on location of the project. By
+	// default the pack is looked up next to the directory of this source file.
+	ss << "\tstd::string defaultPackPath()\n";
+	ss << "\t{\n";
+	ss << "\t\tstd::string file = __FILE__;\n";
+	ss << "\t\tsize_t slash = file.find_last_of(\"/\\\\\");\n";
+	ss << "\t\tfile.resize(slash != std::string::npos ? slash + 1 : 0);\n";
+	ss << "\t\treturn file + \"../";
+	cxxEscape(ss, packName);
+	ss << "\";\n";
+	ss << "\t}\n";
+	ss << '\n';
+	ss << "\tvoid mountPack()\n";
+	ss << "\t{\n";
+	ss << "\t\tstd::string path = (packPath ? std::string(packPath) : defaultPackPath());\n";
+	ss << "\t\tconst unsigned char * data = nullptr;\n";
+	ss << "\t\tsize_t size = 0;\n";
+	ss << "\t#ifdef _WIN32\n";
+	ss << "\t\tHANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,\n";
+	ss << "\t\t\tFILE_ATTRIBUTE_NORMAL, nullptr);\n";
+	ss << "\t\tif (file == INVALID_HANDLE_VALUE)\n";
+	ss << "\t\t\treturn;\n";
+	ss << "\t\tLARGE_INTEGER fileSize;\n";
+	ss << "\t\tif (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)\n";
+	ss << "\t\t{\n";
+	ss << "\t\t\tHANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);\n";
+	ss << "\t\t\tif (mapping)\n";
+	ss << "\t\t\t{\n";
+	ss << "\t\t\t\tdata = static_cast<const unsigned char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));\n";
+	ss << "\t\t\t\tsize = static_cast<size_t>(fileSize.QuadPart);\n";
+	ss << "\t\t\t\tCloseHandle(mapping);\n";
+	ss << "\t\t\t}\n";
+	ss << "\t\t}\n";
+	ss << "\t\tCloseHandle(file);\n";
+	ss << "\t#else\n";
+	ss << "\t\tint fd = open(path.c_str(), O_RDONLY);\n";
+	ss << "\t\tif (fd < 0)\n";
+	ss << "\t\t\treturn;\n";
+	ss << "\t\tstruct stat st;\n";
+	ss << "\t\tif (fstat(fd, &st) == 0 && st.st_size > 0)\n";
+	ss << "\t\t{\n";
+	ss << "\t\t\tvoid * p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);\n";
+	ss << "\t\t\tif (p != MAP_FAILED)\n";
+	ss << "\t\t\t{\n";
+	ss << "\t\t\t\tdata = static_cast<const unsigned char *>(p);\n";
+	ss << "\t\t\t\tsize = static_cast<size_t>(st.st_size);\n";
+	ss << "\t\t\t}\n";
+	ss << "\t\t}\n";
+	ss << "\t\tclose(fd);\n";
+	ss << "\t#endif\n";
+	ss << "\t\tif (!data)\n";
+	ss << "\t\t\treturn;\n";
+	ss << '\n';
+	ss << "\t\tsize_t count = 0;\n";
+	ss << "\t\tunsigned long long indexOffset = 0, namesOffset = 0, namesSize = 0;\n";
+	ss << "\t\tbool valid = (size >= " << PACK_HEADER_SIZE << " && memcmp(data, \"" << PACK_MAGIC
+		<< "\", " << sizeof(PACK_MAGIC) << ") == 0 && readLE(data + 8, 4) == " << PACK_VERSION << ");\n";
+	ss << "\t\tif (valid)\n";
+	ss << "\t\t{\n";
+	ss << "\t\t\tcount = static_cast<size_t>(readLE(data + 12, 4));\n";
+	ss << "\t\t\tindexOffset = readLE(data + 16, 8);\n";
+	ss << "\t\t\tnamesOffset = readLE(data + 24, 8);\n";
+	ss << "\t\t\tnamesSize = readLE(data + 32, 8);\n";
+	ss << "\t\t\tvalid = (indexOffset <= size && count <= (size - indexOffset) / " << PACK_ENTRY_SIZE
+		<< " && namesOffset <= size && namesSize <= size - namesOffset);\n";
+	ss << "\t\t}\n";
+	ss << "\t\tif (!valid)\n";
+	ss << "\t\t{\n";
+	ss << "\t\t#ifdef _WIN32\n";
+	ss << "\t\t\tUnmapViewOfFile(data);\n";
+	ss << "\t\t#else\n";
+	ss << "\t\t\tmunmap(const_cast<unsigned char *>(data), size);\n";
+	ss << "\t\t#endif\n";
+	ss << "\t\t\treturn;\n";
+	ss << "\t\t}\n";
+	ss << '\n';
+	ss << "\t\tpackData = data;\n";
+	ss << "\t\tpackSize = size;\n";
+	ss << "\t\tpackIndex = data + indexOffset;\n";
+	ss << "\t\tpackNames = reinterpret_cast<const char *>(data + namesOffset);\n";
+	ss << "\t\tpackNamesSize = static_cast<size_t>(namesSize);\n";
+	ss << "\t\tnumResources = count;\n";
+	if (hasCompressed)
+		ss << "\t\tcache = new std::atomic<unsigned char *>[count > 0 ? count : 1]();\n";
+	ss << "\t}\n";
+	ss << '\n';
+	ss << "\tsize_t resourceCount()\n";
+	ss << "\t{\n";
+	ss << "\t\tstd::call_once(packMounted, mountPack);\n";
+	ss << "\t\treturn numResources;\n";
+	ss << "\t}\n";
+	ss << '\n';
+	ss << "\tconst char * resourceName(size_t index)\n";
+	ss << "\t{\n";
+	ss << "\t\tsize_t offset = static_cast<size_t>(readLE(packIndex + index * " << PACK_ENTRY_SIZE << " + 40, 4));\n";
+	ss << "\t\treturn (offset < packNamesSize ? packNames + offset : \"\");\n";
+	ss << "\t}\n";
+
+	if (hasCompressed)
+		writeCatalogDataFunctions(ss, hasCompressed, false);
+
+	ss << '\n';
+	ss << "\tbool lookup(const char * name, Found & found)\n";
+	ss << "\t{\n";
+	ss << "\t\tsize_t count = resourceCount();\n";
+	ss << '\n';
+	ss << "\t\tunsigned long long hash = " << resourcePackHash(std::string()) << "ULL;\n";
+	ss << "\t\tfor (const char * p = name; *p; ++p)\n";
+	ss << "\t\t\thash = (hash ^ static_cast<unsigned char>(*p)) * 1099511628211ULL;\n";
+	ss << '\n';
+	ss << "\t\tsize_t lo = 0, hi = count;\n";
+	ss << "\t\twhile (lo < hi)\n";
+	ss << "\t\t{\n";
+	ss << "\t\t\tsize_t mid = lo + (hi - lo) / 2;\n";
+	ss << "\t\t\tif (readLE(packIndex + mid * " << PACK_ENTRY_SIZE << ", 8) < hash)\n";
+	ss << "\t\t\t\tlo = mid + 1;\n";
+	ss << "\t\t\telse\n";
+	ss << "\t\t\t\thi = mid;\n";
+	ss << "\t\t}\n";
+	ss << '\n';
+	ss << "\t\tfor (; lo < count; ++lo)\n";
+	ss << "\t\t{\n";
+	ss << "\t\t\tconst unsigned char * entry = packIndex + lo * " << PACK_ENTRY_SIZE << ";\n";
+	ss << "\t\t\tif (readLE(entry, 8) != hash)\n";
+	ss << "\t\t\t\tbreak;\n";
+	ss << "\t\t\tif (strcmp(resourceName(lo), name) != 0)\n";
+	ss << "\t\t\t\tcontinue;\n";
+	ss << '\n';
+	ss << "\t\t\tunsigned long long offset = readLE(entry + 8, 8);\n";
+	ss << "\t\t\tunsigned long long size = readLE(entry + 16, 8);\n";
+	ss << "\t\t\tif (offset > packSize || size > packSize - offset)\n";
+	ss << "\t\t\t\treturn false;\n";
+	ss << '\n';
+	ss << "\t\t\tfound.data = packData + offset;\n";
+	ss << "\t\t\tfound.size = static_cast<size_t>(size);\n";
+	ss << "\t\t\tfound.compression = static_cast<int>(readLE(entry + 48, 4));\n";
+	if (hasCompressed)
+		ss << "\t\t\tfound.cache = &cache[lo];\n";
+	else
+	{
+		ss << "\t\t\tif (found.compression != " << RESOURCE_COMPRESS_NONE << ")\n";
+		ss << "\t\t\t\treturn false;\n";
+	}
+	ss << "\t\t\treturn true;\n";
+	ss << "\t\t}\n";
+	ss << '\n';
+	ss << "\t\treturn false;\n";
+	ss << "\t}\n";
+	ss << "}\n";
+
+	ss << '\n';
+	ss << "void YIP::setResourcePackPath(const char * path)\n";
+	ss << "{\n";
+	ss << "\tpackPath = path;\n";
+	ss << "}\n";
+	ss << '\n';
+	ss << "void YIP::setResourceRoot(const char *)\n";
+	ss << "{\n";
+	ss << "}\n";
+
+	// The legacy map is not provided: its static initializer would mount the pack before main, so
+	// YIP::setResourcePackPath could never take effect
+	writeCatalogAccessFunctions(ss, hasCompressed);
+}
+
+static void writeResourceHeader(const ProjectPtr & project)
+{
+	std::stringstream ss;
+	std::string guard = sha1("yip/resources.h");
+	ss << "#ifndef __" << guard << "__\n";
+	ss << "#define __" << guard << "__\n";
+	ss << "#include <cstddef>\n";
+	ss << "namespace YIP {\n";
+	ss << "bool findResource(const char * name, const void ** data, size_t * size);\n";
+	ss << "bool getResourceSize(const char * name, size_t * size);\n";
+	ss << "bool readResource(const char * name, void * buffer, size_t bufferSize);\n";
+	ss << "void setResourcePackPath(const char * path);\n";
+	ss << "void setResourceRoot(const char * path);\n";
+	ss << "}\n";
+	ss << "#endif\n";
+
+	std::string path = project->yipDirectory()->writeFile(".yip-import-proxies/yip/resources.h", ss.str());
+	SourceFilePtr sourceFile = project->addSourceFile("yip/resources.h", path);
 	sourceFile->setIsGenerated(true);
-	sourceFile->setPlatforms(platform);
+}
+
+static void makeResourcePack(std::stringstream & ss, const ProjectPtr & project, const ResCatalog & cat,
+	Platform::Type platform)
+{
+	std::vector<SourceFilePtr> files;
+	for (auto it : project->resourceFiles())
+	{
+		if (it.second->platforms() & platform)
+			files.push_back(it.second);
+	}
+
+	std::string packName = fmt() << "resources_"
+		<< std::hex << std::setw(4) << std::setfill('0') << platform << ".pack";
+	std::string packPath = pathConcat(project->yipDirectory()->path(), packName);
+	{
+		// Other yip processes could be updating the same pack
+		FileLock fileLock(project->yipDirectory()->lockFilePath(packName));
+		updateResourcePack(packPath, files, readResourceData);
+	}
+
+	writePackCatalog(ss, cat, platform, packName);
+}
+
+// Catalog for debug builds: resources are read from the source files, so that they could be edited without
+// rebuilding the application. Resource root could be overridden to load resources from another location
+// (e.g. a directory synchronized with the development machine).
+static void writeHotReloadCatalog(std::stringstream & ss, const ResCatalog & cat, Platform::Type platform)
+{
+	size_t count = 0;
+	for (auto it : cat)
+	{
+		if (it.second.platforms & platform)
+			++count;
+	}
+
+	ss << "#include \"../.yip-import-proxies/yip/resources.h\"\n";
+	ss << "#include <cstring>\n";
+	ss << "#include <cstdio>\n";
+	ss << "#include <cstdlib>\n";
+	ss << "#include <string>\n";
+	ss << "#include <mutex>\n";
+	ss << "#include <sys/stat.h>\n";
+	ss << "#ifndef YIP_RESOURCES_NO_LEGACY_MAP\n";
+	ss << "#include <unordered_map>\n";
+	ss << "#endif\n";
+
+	ss << '\n';
+	ss << "namespace\n";
+	ss << "{\n";
+	ss << "\tstruct Resource\n";
+	ss << "\t{\n";
+	ss << "\t\tconst char * name;\n";
+	ss << "\t\tconst char * path;\n";
+	ss << "\t};\n";
+	ss << '\n';
+	ss << "\tstruct Loaded\n";
+	ss << "\t{\n";
+	ss << "\t\tunsigned char * data;\n";
+	ss << "\t\tsize_t size;\n";
+	ss << "\t\ttime_t time;\n";
+	ss << "\t\tstd::string path;\n";
+	ss << "\t};\n";
+	ss << '\n';
+	ss << "\tconst size_t numResources = " << count << ";\n";
+	ss << "\tconst Resource resources[" << (count > 0 ? count : 1) << "] = {\n";
+	for (auto it : cat)
+	{
+		if (!(it.second.platforms & platform))
+			continue;
+
+		ss << "\t\t{ \"";
+		cxxEscape(ss, it.first);
+		ss << "\", \"";
+		cxxEscape(ss, it.second.sourcePath);
+		ss << "\" },\n";
+	}
+	if (count == 0)
+		ss << "\t\t{ nullptr, nullptr },\n";
+	ss << "\t};\n";
+	ss << '\n';
+	ss << "\tLoaded loaded[" << (count > 0 ? count : 1) << "];\n";
+	ss << "\tstd::mutex mutex;\n";
+	ss << "\tstd::string root;\n";
+
+	ss << '\n';
+	ss << "\tbool lookup(const char * name, size_t & index)\n";
+	ss << "\t{\n";
+	ss << "\t\tsize_t lo = 0, hi = numResources;\n";
+	ss << "\t\twhile (lo < hi)\n";
+	ss << "\t\t{\n";
+	ss << "\t\t\tsize_t mid = lo + (hi - lo) / 2;\n";
+	ss << "\t\t\tint r = strcmp(name, resources[mid].name);\n";
+	ss << "\t\t\tif (r < 0)\n";
+	ss << "\t\t\t\thi = mid;\n";
+	ss << "\t\t\telse if (r > 0)\n";
+	ss << "\t\t\t\tlo = mid + 1;\n";
+	ss << "\t\t\telse\n";
+	ss << "\t\t\t{\n";
+	ss << "\t\t\t\tindex = mid;\n";
+	ss << "\t\t\t\treturn true;\n";
+	ss << "\t\t\t}\n";
+	ss << "\t\t}\n";
+	ss << "\t\treturn false;\n";
+	ss << "\t}\n";
+
+	ss << '\n';
+	ss << "\tstd::string resourcePath(size_t index)\n";
+	ss << "\t{\n";
+	ss << "\t\tstd::string dir;\n";
+	ss << "\t\t{\n";
+	ss << "\t\t\tstd::lock_guard<std::mutex> lock(mutex);\n";
+	ss << "\t\t\tdir = root;\n";
+	ss << "\t\t}\n";
+	ss << "\t\tif (dir.empty())\n";
+	ss << "\t\t{\n";
+	ss << "\t\t\tconst char * env = getenv(\"YIP_RESOURCE_ROOT\");\n";
+	ss << "\t\t\tif (env)\n";
+	ss << "\t\t\t\tdir = env;\n";
+	ss << "\t\t}\n";
+	ss << "\t\tif (dir.empty())\n";
+	ss << "\t\t\treturn resources[index].path;\n";
+	ss << "\t\treturn dir + '/' + resources[index].name;\n";
+	ss << "\t}\n";
+
+	ss << '\n';
+	ss << "\tbool readFile(const std::string & path, void * buffer, size_t size)\n";
+	ss << "\t{\n";
+	ss << "\t\tFILE * f = fopen(path.c_str(), \"rb\");\n";
+	ss << "\t\tif (!f)\n";
+	ss << "\t\t\treturn false;\n";
+	ss << "\t\tbool ok = (fread(buffer, 1, size, f) == size);\n";
+	ss << "\t\tfclose(f);\n";
+	ss << "\t\treturn ok;\n";
+	ss << "\t}\n";
+
+	writeCatalogLegacyMapAccessors(ss);
+	ss << "}\n";
+
+	ss << '\n';
+	ss << "void YIP::setResourcePackPath(const char *)\n";
+	ss << "{\n";
+	ss << "}\n";
+	ss << '\n';
+	ss << "void YIP::setResourceRoot(const char * path)\n";
+	ss << "{\n";
+	ss << "\tstd::lock_guard<std::mutex> lock(mutex);\n";
+	ss << "\troot = (path ? path : \"\");\n";
+	ss << "}\n";
+
+	// Pointers returned by findResource could still be in use by the application, so the previous contents
+	// of a changed file are never freed.
+
+	ss << '\n';
+	ss << "bool YIP::findResource(const char * name, const void ** data, size_t * size)\n";
+	ss << "{\n";
+	ss << "\tsize_t index;\n";
+	ss << "\tif (!lookup(name, index))\n";
+	ss << "\t\treturn false;\n";
+	ss << '\n';
+	ss << "\tstd::string path = resourcePath(index);\n";
+	ss << "\tstruct stat st;\n";
+	ss << "\tif (stat(path.c_str(), &st) != 0)\n";
+	ss << "\t\treturn false;\n";
+	ss << '\n';
+	ss << "\tstd::lock_guard<std::mutex> lock(mutex);\n";
+	ss << "\tLoaded & res = loaded[index];\n";
+	ss << "\tsize_t fileSize = static_cast<size_t>(st.st_size);\n";
+	ss << "\tif (!res.data || res.time != st.st_mtime || res.size != fileSize || res.path != path)\n";
+	ss << "\t{\n";
+	ss << "\t\tunsigned char * buffer = static_cast<unsigned char *>(malloc(fileSize > 0 ? fileSize : 1));\n";
+	ss << "\t\tif (!buffer || !readFile(path, buffer, fileSize))\n";
+	ss << "\t\t{\n";
+	ss << "\t\t\tfree(buffer);\n";
+	ss << "\t\t\treturn false;\n";
+	ss << "\t\t}\n";
+	ss << "\t\tres.data = buffer;\n";
+	ss << "\t\tres.size = fileSize;\n";
+	ss << "\t\tres.time = st.st_mtime;\n";
+	ss << "\t\tres.path = path;\n";
+	ss << "\t}\n";
+	ss << '\n';
+	ss << "\tif (data)\n";
+	ss << "\t\t*data = res.data;\n";
+	ss << "\tif (size)\n";
+	ss << "\t\t*size = res.size;\n";
+	ss << "\treturn true;\n";
+	ss << "}\n";
+
+	ss << '\n';
+	ss << "bool YIP::getResourceSize(const char * name, size_t * size)\n";
+	ss << "{\n";
+	ss << "\tsize_t index;\n";
+	ss << "\tif (!lookup(name, index))\n";
+	ss << "\t\treturn false;\n";
+	ss << "\tstruct stat st;\n";
+	ss << "\tif (stat(resourcePath(index).c_str(), &st) != 0)\n";
+	ss << "\t\treturn false;\n";
+	ss << "\tif (size)\n";
+	ss << "\t\t*size = static_cast<size_t>(st.st_size);\n";
+	ss << "\treturn true;\n";
+	ss << "}\n";
+
+	ss << '\n';
+	ss << "bool YIP::readResource(const char * name, void * buffer, size_t bufferSize)\n";
+	ss << "{\n";
+	ss << "\tsize_t index;\n";
+	ss << "\tif (!lookup(name, index))\n";
+	ss << "\t\treturn false;\n";
+	ss << "\tstd::string path = resourcePath(index);\n";
+	ss << "\tstruct stat st;\n";
+	ss << "\tif (stat(path.c_str(), &st) != 0 || bufferSize < static_cast<size_t>(st.st_size))\n";
+	ss << "\t\treturn false;\n";
+	ss << "\treturn readFile(path, buffer, static_cast<size_t>(st.st_size));\n";
+	ss << "}\n";
+
+	writeCatalogLegacyMap(ss);
 }
 
 void compileResources(const ProjectPtr & project)
 {
 	ResCatalog cat;
+	ResBlobs blobs;
+	ThreadPool pool(g_Config->jobs);
+
+	writeResourceHeader(project);
+
+	// Debug builds on platforms with hot reloading read resources from disk, embedded data is not compiled
 
+	Platform::Type hotReloadPlatforms = platformsWithHotReload(project.get(), Platform::All & ~SKIP_PLATFORMS);
+	if (hotReloadPlatforms != 0)
+		project->addDefine("YIP_RESOURCES_HOT_RELOAD", hotReloadPlatforms, BuildType::Debug);
+
+	// Hash contents of the embedded resources in parallel
+
+	std::vector<SourceFilePtr> files;
 	for (auto it : project->resourceFiles())
 	{
 		const SourceFilePtr & file = it.second;
-		if ((file->platforms() & ~SKIP_PLATFORMS) == 0)
+		if ((file->platforms() & ~SKIP_PLATFORMS) != 0)
+			files.push_back(file);
+	}
+
+	std::vector<std::string> hashes(files.size());
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		if (embeddedPlatforms(project, files[i]) == 0)
 			continue;
-		makeResourceFile(cat, project, file);
+
+		const SourceFilePtr & file = files[i];
+		std::string & hash = hashes[i];
+		pool.run([&project, &file, &hash]() {
+			hash = project->yipDirectory()->fileSHA1(file->path());
+		});
+	}
+	pool.wait();
+
+	// Catalog is built in order of resource names to keep the output independent of the scheduling
+
+	for (size_t i = 0; i < files.size(); i++)
+		addResourceToCatalog(cat, blobs, project, files[i], hashes[i]);
+
+	// Generate embedded data in parallel
+
+	for (auto & it : blobs)
+	{
+		const std::string & targetName = it.first;
+		ResBlob & blob = it.second;
+		pool.run([&project, &targetName, &blob]() {
+			makeResourceFile(project, targetName, blob);
+		});
+	}
+	pool.wait();
+
+	for (const auto & it : blobs)
+	{
+		for (const ResOutput & output : it.second.outputs)
+		{
+			SourceFilePtr sourceFile = project->addSourceFile(output.name, output.path);
+			sourceFile->setIsGenerated(true);
+			sourceFile->setPlatforms(output.platforms);
+		}
 	}
 
 	for (size_t i = 1; i < 0xFFFF; i <<= 1)
 	{
 		if ((i & SKIP_PLATFORMS) != 0)
 			continue;
-		writeResourceCatalog(project, cat, static_cast<Platform::Type>(i));
+
+		Platform::Type platform = static_cast<Platform::Type>(i);
+		bool hotReload = project->resourceOptions(platform).hotReload;
+
+		std::stringstream ss;
+		if (hotReload)
+		{
+			ss << "#ifdef YIP_RESOURCES_HOT_RELOAD\n";
+			writeHotReloadCatalog(ss, cat, platform);
+			ss << "#else\n";
+		}
+
+		if (platformsWithEmbedding(project.get(), platform, RESOURCE_EMBED_PACK) != 0)
+			makeResourcePack(ss, project, cat, platform);
+		else
+			writeResourceCatalog(ss, cat, blobs, platform);
+
+		if (hotReload)
+			ss << "#endif\n";
+
+		addCatalogFile(project, catalogFileName(platform), ss.str(), platform);
 	}
 }
@@ -0,0 +1,86 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "resource_options.h"
+#include "../util/cxx-util/cxx-util/fmt.h"
+#include <stdexcept>
+#include <cstdlib>
+
+ResourceOptions::ResourceOptions()
+	: embedding(RESOURCE_EMBED_CXX),
+	  shardSize(0),
+	  hotReload(false)
+{
+}
+
+ResourceEmbedding resourceEmbeddingFromString(const std::string & name)
+{
+	if (name == "cxx")
+		return RESOURCE_EMBED_CXX;
+	if (name == "incbin")
+		return RESOURCE_EMBED_INCBIN;
+	if (name == "pack")
+		return RESOURCE_EMBED_PACK;
+	throw std::runtime_error(fmt() << "invalid resource embedding mode '" << name << "'.");
+}
+
+ResourceCompression resourceCompressionFromString(const std::string & name)
+{
+	if (name == "none")
+		return RESOURCE_COMPRESS_NONE;
+	if (name == "deflate")
+		return RESOURCE_COMPRESS_DEFLATE;
+	if (name == "fast")
+		return RESOURCE_COMPRESS_FAST;
+	throw std::runtime_error(fmt() << "invalid resource compression mode '" << name << "'.");
+}
+
+size_t resourceShardSizeFromString(const std::string & value)
+{
+	const char * p = value.c_str();
+	char * end = nullptr;
+	unsigned long long size = strtoull(p, &end, 10);
+
+	unsigned long long multiplier = 1;
+	if (end != p && *end)
+	{
+		switch (*end++)
+		{
+		case 'k': case 'K': multiplier = 1024ULL; break;
+		case 'm': case 'M': multiplier = 1024ULL * 1024; break;
+		case 'g': case 'G': multiplier = 1024ULL * 1024 * 1024; break;
+		default: --end;
+		}
+	}
+
+	if (end == p || *end || size > static_cast<size_t>(-1) / multiplier)
+		throw std::runtime_error(fmt() << "invalid resource shard size '" << value << "'.");
+
+	size *= multiplier;
+	if (size != 0 && size < RESOURCE_MIN_SHARD_SIZE)
+	{
+		throw std::runtime_error(fmt() << "resource shard size should be at least "
+			<< RESOURCE_MIN_SHARD_SIZE << " bytes.");
+	}
+
+	return static_cast<size_t>(size);
+}
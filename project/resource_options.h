@@ -0,0 +1,59 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __5440cfd0024148a9998c514c1cf4432d__
+#define __5440cfd0024148a9998c514c1cf4432d__
+
+#include <cstddef>
+#include <string>
+
+enum ResourceEmbedding
+{
+	RESOURCE_EMBED_CXX = 0,			// Array of bytes in a generated C++ source file
+	RESOURCE_EMBED_INCBIN,			// Assembler stub with the `.incbin` directive
+	RESOURCE_EMBED_PACK,			// Resource pack mapped into memory at runtime
+};
+
+enum ResourceCompression
+{
+	RESOURCE_COMPRESS_NONE = 0,		// Resource is stored as is
+	RESOURCE_COMPRESS_DEFLATE,		// zlib stream with maximum compression
+	RESOURCE_COMPRESS_FAST,			// Raw deflate stream without checksum
+};
+
+// Smallest allowed size of a resource shard
+#define RESOURCE_MIN_SHARD_SIZE 1024
+
+struct ResourceOptions
+{
+	ResourceEmbedding embedding;
+	size_t shardSize;				// Resources larger than this are split into multiple files (0 = never)
+	bool hotReload;					// Debug builds read resources from disk
+
+	ResourceOptions();
+};
+
+ResourceEmbedding resourceEmbeddingFromString(const std::string & name);
+ResourceCompression resourceCompressionFromString(const std::string & name);
+size_t resourceShardSizeFromString(const std::string & value);
+
+#endif
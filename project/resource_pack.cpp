@@ -0,0 +1,414 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "resource_pack.h"
+#include "../util/cxx-util/cxx-util/fmt.h"
+#include "../util/path-util/path-util.h"
+#include "../util/stat_cache.h"
+#include "../util/file_sync.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+#ifdef _WIN32
+ #include <io.h>
+#else
+ #include <unistd.h>
+#endif
+
+// Pack is rebuilt from scratch when unused space occupies more than a half of it
+#define PACK_COMPACT_THRESHOLD (1024 * 1024)
+
+namespace
+{
+	struct Entry
+	{
+		std::string name;
+		unsigned long long hash;
+		unsigned long long offset;
+		unsigned long long size;
+		unsigned long long capacity;
+		long long mtime;
+		unsigned compression;
+	};
+
+	class PackFile
+	{
+	public:
+		PackFile(const std::string & path, const char * mode)
+			: m_Path(path)
+		{
+			m_File = fopen(path.c_str(), mode);
+		}
+
+		~PackFile()
+		{
+			if (m_File)
+				fclose(m_File);
+		}
+
+		inline bool isOpen() const { return m_File != nullptr; }
+		inline FILE * handle() const { return m_File; }
+
+		void seek(unsigned long long offset)
+		{
+		  #ifdef _WIN32
+			int r = _fseeki64(m_File, static_cast<__int64>(offset), SEEK_SET);
+		  #else
+			int r = fseeko(m_File, static_cast<off_t>(offset), SEEK_SET);
+		  #endif
+			if (r != 0)
+				throw std::runtime_error(fmt() << "unable to seek in file '" << m_Path << "': " << strerror(errno));
+		}
+
+		bool read(void * data, size_t size)
+		{
+			return fread(data, 1, size, m_File) == size;
+		}
+
+		void write(const void * data, size_t size)
+		{
+			if (fwrite(data, 1, size, m_File) != size)
+				throw std::runtime_error(fmt() << "unable to write file '" << m_Path << "': " << strerror(errno));
+		}
+
+		void flush()
+		{
+			if (fflush(m_File) != 0)
+				throw std::runtime_error(fmt() << "unable to write file '" << m_Path << "': " << strerror(errno));
+		}
+
+		void truncate(unsigned long long size)
+		{
+			fflush(m_File);
+		  #ifdef _WIN32
+			int r = _chsize_s(_fileno(m_File), static_cast<__int64>(size));
+		  #else
+			int r = ftruncate(fileno(m_File), static_cast<off_t>(size));
+		  #endif
+			if (r != 0)
+				throw std::runtime_error(fmt() << "unable to truncate file '" << m_Path << "': " << strerror(errno));
+		}
+
+		void close()
+		{
+			FILE * f = m_File;
+			m_File = nullptr;
+			if (fclose(f) != 0)
+				throw std::runtime_error(fmt() << "unable to write file '" << m_Path << "': " << strerror(errno));
+		}
+
+	private:
+		std::string m_Path;
+		FILE * m_File;
+
+		PackFile(const PackFile &) = delete;
+		PackFile & operator=(const PackFile &) = delete;
+	};
+}
+
+static unsigned long long alignOffset(unsigned long long offset, unsigned long long alignment)
+{
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+static unsigned long long getLE(const unsigned char * p, size_t size)
+{
+	unsigned long long value = 0;
+	for (size_t i = size; i > 0; i--)
+		value = (value << 8) | p[i - 1];
+	return value;
+}
+
+static void putLE(unsigned char * p, unsigned long long value, size_t size)
+{
+	for (size_t i = 0; i < size; i++, value >>= 8)
+		p[i] = static_cast<unsigned char>(value & 0xFF);
+}
+
+unsigned long long resourcePackHash(const std::string & name)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	for (char ch : name)
+	{
+		hash ^= static_cast<unsigned char>(ch);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// Returns entries of the pack and the end of the area referenced by its header
+static bool readPackIndex(const std::string & path, std::map<std::string, Entry> & entries,
+	unsigned long long & usedEnd)
+{
+	PackFile file(path, "rb");
+	if (!file.isOpen())
+		return false;
+
+	unsigned char header[PACK_HEADER_SIZE];
+	if (!file.read(header, sizeof(header)) || memcmp(header, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0)
+		return false;
+	if (getLE(header + 8, 4) != PACK_VERSION)
+		return false;
+
+	size_t count = static_cast<size_t>(getLE(header + 12, 4));
+	unsigned long long indexOffset = getLE(header + 16, 8);
+	unsigned long long namesOffset = getLE(header + 24, 8);
+	size_t namesSize = static_cast<size_t>(getLE(header + 32, 8));
+	usedEnd = std::max(getLE(header + 40, 8), namesOffset + namesSize);
+	usedEnd = std::max(usedEnd, indexOffset + count * PACK_ENTRY_SIZE);
+	if (usedEnd < PACK_HEADER_SIZE)
+		return false;
+
+	std::vector<char> names(namesSize);
+	file.seek(namesOffset);
+	if (!file.read(names.data(), names.size()))
+		return false;
+
+	std::vector<unsigned char> index(count * PACK_ENTRY_SIZE);
+	file.seek(indexOffset);
+	if (!file.read(index.data(), index.size()))
+		return false;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const unsigned char * p = &index[i * PACK_ENTRY_SIZE];
+
+		size_t nameOffset = static_cast<size_t>(getLE(p + 40, 4));
+		size_t nameLength = static_cast<size_t>(getLE(p + 44, 4));
+		if (nameOffset + nameLength > names.size())
+			return false;
+
+		Entry entry;
+		entry.name = std::string(&names[nameOffset], nameLength);
+		entry.hash = getLE(p, 8);
+		entry.offset = getLE(p + 8, 8);
+		entry.size = getLE(p + 16, 8);
+		entry.capacity = getLE(p + 24, 8);
+		entry.mtime = static_cast<long long>(getLE(p + 32, 8));
+		entry.compression = static_cast<unsigned>(getLE(p + 48, 4));
+		entries.insert(std::make_pair(entry.name, entry));
+	}
+
+	return true;
+}
+
+static unsigned long long getFileSize(const std::string & path)
+{
+	FILE * f = fopen(path.c_str(), "rb");
+	if (!f)
+		throw std::runtime_error(fmt() << "unable to open file '" << path << "'.");
+
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	bool error = (ferror(f) || size < 0);
+	fclose(f);
+
+	if (error)
+		throw std::runtime_error(fmt() << "unable to determine size of file '" << path << "'.");
+
+	return static_cast<unsigned long long>(size);
+}
+
+// Pack is updated in a way that keeps it valid at any moment. Changed resources, names and index are written
+// after the area referenced by the current header, and the header is rewritten last, after everything else has
+// been flushed to the disk. When the pack is rebuilt from scratch, it is written into a temporary file that
+// replaces the pack when complete. Caller should hold the lock of the pack.
+bool updateResourcePack(const std::string & path, const std::vector<SourceFilePtr> & files,
+	const ResourceReader & reader)
+{
+	std::map<std::string, Entry> oldEntries;
+	unsigned long long usedEnd = PACK_HEADER_SIZE;
+	bool rebuild = !readPackIndex(path, oldEntries, usedEnd);
+
+	// Check whether pack should be compacted
+
+	unsigned long long usedSize = 0;
+	for (const SourceFilePtr & file : files)
+	{
+		auto it = oldEntries.find(file->name());
+		if (it != oldEntries.end())
+			usedSize += it->second.capacity;
+	}
+	if (usedEnd - PACK_HEADER_SIZE > PACK_COMPACT_THRESHOLD && usedEnd - PACK_HEADER_SIZE > usedSize * 2)
+		rebuild = true;
+
+	if (rebuild)
+	{
+		oldEntries.clear();
+		usedEnd = PACK_HEADER_SIZE;
+	}
+
+	std::string packFile = (rebuild ? path + ".tmp" : path);
+	PackFile pack(packFile, rebuild ? "w+b" : "r+b");
+	if (!pack.isOpen())
+		throw std::runtime_error(fmt() << "unable to open file '" << packFile << "': " << strerror(errno));
+
+	// Store changed resources into the pack
+
+	std::vector<Entry> entries;
+	entries.reserve(files.size());
+	unsigned long long dataEnd = usedEnd;
+	size_t numChanged = 0;
+
+	for (const SourceFilePtr & file : files)
+	{
+		Entry entry;
+		entry.name = file->name();
+		entry.hash = resourcePackHash(file->name());
+		entry.mtime = static_cast<long long>(cachedPathGetModificationTime(file->path()));
+		entry.compression = static_cast<unsigned>(file->compression());
+
+		auto it = oldEntries.find(file->name());
+		if (it != oldEntries.end() && it->second.mtime == entry.mtime && it->second.compression == entry.compression)
+		{
+			entries.push_back(it->second);
+			continue;
+		}
+
+		// Size of the uncompressed data is known in advance, so it could be streamed into the pack.
+		// Compressed data is generated into memory first.
+
+		std::vector<unsigned char> buffer;
+		if (file->compression() == RESOURCE_COMPRESS_NONE)
+			entry.size = getFileSize(file->path());
+		else
+		{
+			reader(file, [&buffer](const void * data, size_t size) {
+				const unsigned char * p = reinterpret_cast<const unsigned char *>(data);
+				buffer.insert(buffer.end(), p, p + size);
+			});
+			entry.size = buffer.size();
+		}
+
+		// Slots referenced by the current index are never overwritten
+		entry.offset = alignOffset(dataEnd, PACK_DATA_ALIGNMENT);
+		entry.capacity = entry.size;
+		dataEnd = entry.offset + entry.size;
+
+		pack.seek(entry.offset);
+		if (file->compression() != RESOURCE_COMPRESS_NONE)
+			pack.write(buffer.data(), buffer.size());
+		else
+		{
+			unsigned long long written = 0;
+			reader(file, [&pack, &written, &entry, &file](const void * data, size_t size) {
+				if (written + size > entry.size)
+					throw std::runtime_error(fmt() << "file '" << file->path() << "' has been modified while reading.");
+				pack.write(data, size);
+				written += size;
+			});
+			if (written != entry.size)
+				throw std::runtime_error(fmt() << "file '" << file->path() << "' has been modified while reading.");
+		}
+
+		entries.push_back(entry);
+		++numChanged;
+	}
+
+	std::string fileName = pathGetFileName(path);
+	if (!rebuild && numChanged == 0 && entries.size() == oldEntries.size())
+	{
+		std::cout << "keeping " << fileName << std::endl;
+		return false;
+	}
+
+	std::cout << "writing " << fileName << " (" << numChanged << " of " << entries.size()
+		<< " resources changed)" << std::endl;
+
+	// Write names table
+
+	std::sort(entries.begin(), entries.end(), [](const Entry & a, const Entry & b) {
+		return (a.hash != b.hash ? a.hash < b.hash : a.name < b.name);
+	});
+
+	std::vector<char> names;
+	std::vector<unsigned char> index(entries.size() * PACK_ENTRY_SIZE);
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const Entry & entry = entries[i];
+		unsigned char * p = &index[i * PACK_ENTRY_SIZE];
+		putLE(p, entry.hash, 8);
+		putLE(p + 8, entry.offset, 8);
+		putLE(p + 16, entry.size, 8);
+		putLE(p + 24, entry.capacity, 8);
+		putLE(p + 32, static_cast<unsigned long long>(entry.mtime), 8);
+		putLE(p + 40, names.size(), 4);
+		putLE(p + 44, entry.name.length(), 4);
+		putLE(p + 48, entry.compression, 4);
+		putLE(p + 52, 0, 4);
+
+		names.insert(names.end(), entry.name.begin(), entry.name.end());
+		names.push_back(0);
+	}
+
+	unsigned long long namesOffset = alignOffset(dataEnd, 8);
+	pack.seek(namesOffset);
+	pack.write(names.data(), names.size());
+
+	// Write index
+
+	unsigned long long indexOffset = alignOffset(namesOffset + names.size(), 8);
+	pack.seek(indexOffset);
+	pack.write(index.data(), index.size());
+	pack.truncate(indexOffset + index.size());
+
+	// Write header. Everything it refers to should be on the disk before it is written.
+
+	pack.flush();
+	fileSync(packFile);
+
+	unsigned char header[PACK_HEADER_SIZE];
+	memset(header, 0, sizeof(header));
+	memcpy(header, PACK_MAGIC, sizeof(PACK_MAGIC));
+	putLE(header + 8, PACK_VERSION, 4);
+	putLE(header + 12, entries.size(), 4);
+	putLE(header + 16, indexOffset, 8);
+	putLE(header + 24, namesOffset, 8);
+	putLE(header + 32, names.size(), 8);
+	putLE(header + 40, dataEnd, 8);
+	pack.seek(0);
+	pack.write(header, sizeof(header));
+
+	pack.close();
+
+	if (rebuild)
+	{
+		// rename() atomically replaces the target on POSIX systems, but fails on Windows if the target exists
+	  #ifdef _WIN32
+		remove(path.c_str());
+	  #endif
+		if (rename(packFile.c_str(), path.c_str()) != 0)
+		{
+			int err = errno;
+			remove(packFile.c_str());
+			throw std::runtime_error(fmt() << "unable to rename file '" << packFile << "' to '"
+				<< path << "': " << strerror(err));
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,73 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __6f52268594b3410d9f3388b98e2aaa6e__
+#define __6f52268594b3410d9f3388b98e2aaa6e__
+
+#include "source_file.h"
+#include "yip_directory.h"
+#include <functional>
+#include <vector>
+#include <string>
+
+// Layout of the resource pack (all numbers are little endian):
+//
+//   header       PACK_HEADER_SIZE bytes, see below
+//   data         blobs of resources, each aligned to PACK_DATA_ALIGNMENT bytes
+//   names        zero-terminated names of resources
+//   index        PACK_ENTRY_SIZE bytes per resource, sorted by hash of the name and then by name
+//
+// Header:
+//    0  char[8]  magic ("YIPPACK\0")
+//    8  u32      version
+//   12  u32      number of entries in the index
+//   16  u64      offset of the index
+//   24  u64      offset of the names table
+//   32  u64      size of the names table
+//   40  u64      end of the data area
+//
+// Index entry:
+//    0  u64      FNV-1a hash of the name
+//    8  u64      offset of the data
+//   16  u64      size of the data
+//   24  u64      size of the slot reserved for the data
+//   32  i64      modification time of the source file
+//   40  u32      offset of the name in the names table
+//   44  u32      length of the name
+//   48  u32      compression (ResourceCompression)
+//   52  u32      reserved
+
+#define PACK_MAGIC "YIPPACK"
+#define PACK_VERSION 1
+#define PACK_HEADER_SIZE 64
+#define PACK_ENTRY_SIZE 56
+#define PACK_DATA_ALIGNMENT 16
+
+typedef std::function<void(const SourceFilePtr & file, const YipDirectory::WriteFunc & write)> ResourceReader;
+
+unsigned long long resourcePackHash(const std::string & name);
+
+// Returns true if pack has been modified
+bool updateResourcePack(const std::string & path, const std::vector<SourceFilePtr> & files,
+	const ResourceReader & reader);
+
+#endif
@@ -24,6 +24,7 @@
 #define __cd8034b5cabf20e1be1ba06b0fc20482__
 
 #include "platform.h"
+#include "resource_options.h"
 #include "../util/file_type.h"
 #include <string>
 #include <memory>
@@ -49,11 +50,15 @@ public:
 	inline bool isGenerated() const { return m_IsGenerated; }
 	inline void setIsGenerated(bool flag) { m_IsGenerated = flag; }
 
+	inline ResourceCompression compression() const { return m_Compression; }
+	inline void setCompression(ResourceCompression mode) { m_Compression = mode; }
+
 private:
 	std::string m_Name;
 	std::string m_Path;
 	FileType m_Type;
 	Platform::Type m_Platforms;
+	ResourceCompression m_Compression;
 	bool m_ArcEnabled;
 	bool m_IsGenerated;
 
@@ -22,145 +22,642 @@
 //
 #include "yip_directory.h"
 #include "project.h"
+#include "../config.h"
 #include "../util/cxx-util/cxx-util/write_file.h"
 #include "../util/cxx-util/cxx-util/fmt.h"
 #include "../util/path-util/path-util.h"
 #include "../util/sha1.h"
+#include "../util/content_hash.h"
+#include "../util/file_stat.h"
+#include "../util/file_lock.h"
+#include "../util/stat_cache.h"
+#include "../util/file_sync.h"
+#include "../util/binary_stream.h"
+#include <algorithm>
 #include <cassert>
+#include <iomanip>
 #include <iostream>
 #include <cerrno>
 #include <cstring>
+#include <cstdio>
+#include <vector>
 
-#define DATABASE_VERSION 1
+#define DATABASE_VERSION 6
+
+// Usage time of the generated files is stored with this resolution (in seconds), so that records of the files
+// that did not change are not rewritten on every run
+#define USAGE_TIME_RESOLUTION 3600
+
+// Garbage collector never deletes files used during this number of seconds (minimum age is one day)
+#define GC_MIN_AGE 86400
+
+static bool tableHasColumn(const SQLiteDatabasePtr & db, const char * table, const char * column)
+{
+	bool found = false;
+	db->select(fmt() << "PRAGMA table_info(" << table << ")", [column, &found](const SQLiteCursor & cursor) {
+		if (cursor.toString(1) == column)
+			found = true;
+	});
+	return found;
+}
+
+// Returns path relative to the directory, or the path itself if it is outside of the directory
+static std::string pathRelativeToDirectory(const std::string & path, const std::string & dir)
+{
+	std::string prefix = dir + '/';
+	if (path.compare(0, prefix.length(), prefix) != 0)
+		return path;
+	return path.substr(prefix.length());
+}
+
+// Converts absolute paths stored by older versions of yip into relative ones
+static void makeStoredPathsRelative(const SQLiteDatabasePtr & db, const std::string & yipPath)
+{
+	std::vector<std::string> files;
+	db->select("SELECT path FROM files", [&files](const SQLiteCursor & cursor) {
+		files.push_back(cursor.toString(0));
+	});
+	for (const std::string & file : files)
+	{
+		std::string path = pathRelativeToDirectory(file, yipPath);
+		if (path != file)
+			db->exec("UPDATE files SET path = ? WHERE path = ?", { path, file });
+	}
+
+	std::string projectPath = pathGetDirectory(yipPath);
+	std::vector<std::string> sources;
+	db->select("SELECT DISTINCT source FROM file_inputs", [&sources](const SQLiteCursor & cursor) {
+		sources.push_back(cursor.toString(0));
+	});
+	for (const std::string & source : sources)
+	{
+		std::string path = pathRelativeToDirectory(source, projectPath);
+		if (path != source)
+			db->exec("UPDATE file_inputs SET source = ? WHERE source = ?", { path, source });
+	}
+}
 
 YipDirectory::YipDirectory(const std::string & prjPath, const Project * project)
 	: m_Path(pathConcat(prjPath, ".yip")),
-	  m_Project(project)
+	  m_Project(project),
+	  m_CompareContents(g_Config->changeDetection == CHANGE_DETECTION_CONTENT),
+	  m_Explain(false)
 {
 	pathCreate(m_Path);
 	m_Path = pathMakeCanonical(m_Path);
+	m_ProjectPath = pathGetDirectory(m_Path);
+	pathCreate(pathConcat(m_Path, "locks"));
 
 	m_DB = std::make_shared<SQLiteDatabase>(pathConcat(m_Path, "db"));
 	initDB();
+
+	// Files generated by other versions of yip could differ, so hash of the executable is part of the cache keys
+	m_GeneratorHash = fileSHA1(pathGetThisExecutableFile());
+	if (!g_Config->outputCacheDir.empty())
+		m_OutputCache.reset(new FileCache(g_Config->outputCacheDir));
 }
 
 YipDirectory::~YipDirectory()
 {
+	try
+	{
+		flush();
+	}
+	catch (const std::exception & e)
+	{
+		std::cerr << "warning: unable to update database: " << e.what() << std::endl;
+	}
 }
 
 bool YipDirectory::didBuildIOS() const
 {
+	std::lock_guard<std::mutex> lock(m_Mutex);
 	return m_DB->queryInt("SELECT value FROM did_build_ios WHERE id = 1 LIMIT 1") != 0;
 }
 
 void YipDirectory::setDidBuildIOS()
 {
+	std::lock_guard<std::mutex> lock(m_Mutex);
 	m_DB->exec(fmt() << "REPLACE INTO did_build_ios (id, value) VALUES (1, 1)");
 }
 
 bool YipDirectory::didBuildAndroid() const
 {
+	std::lock_guard<std::mutex> lock(m_Mutex);
 	return m_DB->queryInt("SELECT value FROM did_build_android WHERE id = 1 LIMIT 1") != 0;
 }
 
 void YipDirectory::setDidBuildAndroid()
 {
+	std::lock_guard<std::mutex> lock(m_Mutex);
 	m_DB->exec(fmt() << "REPLACE INTO did_build_android (id, value) VALUES (1, 1)");
 }
 
 bool YipDirectory::didBuildTizen() const
 {
+	std::lock_guard<std::mutex> lock(m_Mutex);
 	return m_DB->queryInt("SELECT value FROM did_build_tizen WHERE id = 1 LIMIT 1") != 0;
 }
 
 void YipDirectory::setDidBuildTizen()
 {
+	std::lock_guard<std::mutex> lock(m_Mutex);
 	m_DB->exec(fmt() << "REPLACE INTO did_build_tizen (id, value) VALUES (1, 1)");
 }
 
 bool YipDirectory::shouldProcessFile(const std::string & path, const std::string & sourcePath,
 	bool rebuildIfProjectFileChanged)
 {
+	static const std::set<std::string> noProjectFiles;
+	return shouldProcessFile(path, sourcePath,
+		(rebuildIfProjectFileChanged ? m_Project->projectFiles() : noProjectFiles));
+}
+
+bool YipDirectory::shouldProcessFile(const std::string & path, const std::string & sourcePath,
+	const std::set<std::string> & projectFiles)
+{
+	if (m_CompareContents)
+		return shouldProcessFileByContents(path, sourcePath, projectFiles);
+
 	std::string targetFile = pathSimplify(pathConcat(m_Path, path));
 
 	// Always process input file if output file does not exist
-	if (!pathIsExistent(targetFile))
-		return true;
+	if (!cachedPathIsExistent(targetFile))
+		return explain(path, true, "output file does not exist");
 
 	// There is no good way to handle non-existence of the input file. Leave it to the caller.
-	if (!pathIsExistent(sourcePath))
-		return true;
+	if (!cachedPathIsExistent(sourcePath))
+		return explain(path, true, "input file does not exist", sourcePath);
 
 	// Canonicalize output file path
-	targetFile = pathMakeCanonical(targetFile);
+	targetFile = cachedPathMakeCanonical(targetFile);
 
 	// Get information about file from the database
-	bool found = false;
-	time_t old_time = 0;
-	m_DB->select("SELECT time FROM files WHERE path = ? LIMIT 1", { targetFile },
-		[&found, &old_time](const SQLiteCursor & cursor) {
-			found = true;
-			old_time = cursor.toTimeT(0);
-		}
-	);
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	FileInfo * info = findFileInfo(targetFile);
+	if (!info)
+	{
+		// This file was never built. Build it now.
+		return explain(path, true, "no database record");
+	}
+	bool collectable = markFileUsed(targetFile, *info);
+	time_t old_time = info->time;
+	lock.unlock();
 
-	// This file was never built. Build it now.
-	if (!found)
-		return true;
+	if (collectable && !keepFile(path, targetFile))
+		return explain(path, true, "output file does not exist");
 
 	// Check whether file has been modified since last build.
-	time_t modificationTime = pathGetModificationTime(sourcePath);
+	time_t modificationTime = cachedPathGetModificationTime(sourcePath);
 	if (modificationTime > old_time)
-		return true;
+		return explain(path, true, "input file is newer", sourcePath);
+
+	// Also rebuild the file if any of the given project files has been modified since last build
+	for (const std::string & projectFile : projectFiles)
+	{
+		if (cachedPathGetModificationTime(projectFile) > old_time)
+			return explain(path, true, "project file is newer", projectFile);
+	}
+
+	return explain(path, false, "up to date", sourcePath);
+}
+
+bool YipDirectory::shouldProcessFileByContents(const std::string & path, const std::string & sourcePath,
+	const std::set<std::string> & projectFiles)
+{
+	// There is no good way to handle non-existence of the input file. Leave it to the caller.
+	if (!cachedPathIsExistent(sourcePath))
+		return explain(path, true, "input file does not exist", sourcePath);
+
+	// Always process input file if output file does not exist
+	std::string targetFile = pathSimplify(pathConcat(m_Path, path));
+	bool changed = !cachedPathIsExistent(targetFile);
+	if (changed)
+		explain(path, true, "output file does not exist");
+	else
+	{
+		targetFile = cachedPathMakeCanonical(targetFile);
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		FileInfo * info = findFileInfo(targetFile);
+		bool collectable = (info && markFileUsed(targetFile, *info));
+		lock.unlock();
+
+		if (collectable && !keepFile(path, targetFile))
+			changed = explain(path, true, "output file does not exist");
+	}
+
+	// All inputs are checked, so that their hashes are stored when the output file is written
+	if (inputHasChanged(path, sourcePath))
+		changed = explain(path, true, "input file has changed", sourcePath);
+	for (const std::string & projectFile : projectFiles)
+	{
+		if (inputHasChanged(path, projectFile))
+			changed = explain(path, true, "project file has changed", projectFile);
+	}
+
+	if (!changed)
+		explain(path, false, "up to date", sourcePath);
+
+	return changed;
+}
+
+bool YipDirectory::inputHasChanged(const std::string & path, const std::string & sourcePath)
+{
+	std::string source = cachedPathMakeCanonical(sourcePath);
+	std::string hash = fileSHA1(source);
+	source = relativeInputPath(source);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto it = m_Inputs.find(path);
+	if (it != m_Inputs.end())
+	{
+		auto jt = it->second.find(source);
+		if (jt != it->second.end() && jt->second == hash)
+			return false;
+	}
+
+	// Hash is stored when the output file is written
+	m_PendingInputs[path][source] = hash;
+	return true;
+}
+
+void YipDirectory::storePendingInputs(const std::string & path)
+{
+	auto it = m_PendingInputs.find(path);
+	if (it == m_PendingInputs.end())
+		return;
+
+	std::map<std::string, std::string> & inputs = m_Inputs[path];
+	std::map<std::string, std::string> & dirtyInputs = m_DirtyInputs[path];
+	for (const auto & input : it->second)
+	{
+		inputs[input.first] = input.second;
+		dirtyInputs[input.first] = input.second;
+	}
+
+	m_PendingInputs.erase(it);
+}
+
+YipDirectory::FileInfo * YipDirectory::findFileInfo(const std::string & file)
+{
+	auto it = m_Files.find(file);
+	return (it != m_Files.end() ? &it->second : nullptr);
+}
+
+// Reads contents of the file into the specified hasher
+static void hashFileContents(const std::string & file, Hasher & hasher)
+{
+	FILE * f = fopen(file.c_str(), "rb");
+	if (!f)
+		throw std::runtime_error(fmt() << "unable to open file '" << file << "'.");
+
+	try
+	{
+		char buf[65536];
+		for (;;)
+		{
+			size_t bytesRead = fread(buf, 1, sizeof(buf), f);
+			if (ferror(f))
+				throw std::runtime_error(fmt() << "unable to read file '" << file << "'.");
+			if (bytesRead == 0)
+				break;
+			hasher.update(buf, bytesRead);
+		}
+	}
+	catch (...)
+	{
+		fclose(f);
+		throw;
+	}
+	fclose(f);
+}
+
+void YipDirectory::setFileInfo(const std::string & file, size_t size, const std::string & hash)
+{
+	FileStat st;
+	FileInfo & info = m_Files[file];
+	info.size = size;
+	info.time = time(nullptr);
+	info.mtime = (cachedFileStat(file, st) ? st.modificationTimeNs : 0);
+	info.used = info.time;
+	info.hash = hash;
+	info.sha1.clear();
+	m_DirtyFiles.insert(file);
+}
+
+// Returns true if the file could be deleted by the garbage collector of another process before the usage time
+// is flushed to the database
+bool YipDirectory::markFileUsed(const std::string & file, FileInfo & info)
+{
+	time_t now = time(nullptr);
+	bool collectable = (now - info.used >= GC_MIN_AGE);
+	if (now - info.used >= USAGE_TIME_RESOLUTION)
+	{
+		info.used = now;
+		m_DirtyFiles.insert(file);
+	}
+	return collectable;
+}
+
+// Stores usage time of the file into the database immediately. The file lock is held, so that the garbage
+// collector either sees the new usage time or has already deleted the file. Returns false in the latter case.
+bool YipDirectory::keepFile(const std::string & path, const std::string & file)
+{
+	FileLock fileLock(lockFilePath(path));
 
-	// Also rebuild the file if Yipfile has been modified since last build
-	if (rebuildIfProjectFileChanged &&
-			m_Project->hasModificationTime() && m_Project->modificationTime() > old_time)
+	FileStat st;
+	if (!fileStat(file, st))
+	{
+		statCacheInvalidate(file);
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_DB->exec("UPDATE files SET used = ? WHERE path = ?", { fmt() << time(nullptr), relativeFilePath(file) });
+	return true;
+}
+
+// Another process could have rewritten the file after it has been recorded, so the file is considered unchanged
+// only if its modification time is exactly the recorded one. Restoring, moving or copying the .yip directory
+// changes modification times of all files, so in that case the contents are compared with the recorded hash,
+// and the new modification time is recorded if they match.
+bool YipDirectory::fileMatchesInfo(const std::string & file, FileInfo & info)
+{
+	if (info.mtime == 0)
+		return cachedPathGetModificationTime(file) <= info.time;
+
+	FileStat st;
+	if (!cachedFileStat(file, st) || st.size != info.size)
+		return false;
+	if (st.modificationTimeNs == info.mtime)
 		return true;
+	if (info.hash.empty())
+		return false;
+
+	ContentHashContext hashContext;
+	hashFileContents(file, hashContext);
+	if (hashContext.finish() != info.hash)
+		return false;
+
+	info.mtime = st.modificationTimeNs;
+	m_DirtyFiles.insert(file);
+	return true;
+}
+
+void YipDirectory::addExplanation(const std::string & path, const char * decision, const char * reason,
+	const std::string & detail)
+{
+	if (!m_Explain)
+		return;
+
+	Explanation explanation;
+	explanation.decision = decision;
+	explanation.reason = reason;
+	explanation.detail = detail;
+
+	std::lock_guard<std::mutex> lock(m_ExplainMutex);
+	m_Explanations[path].push_back(std::move(explanation));
+}
+
+bool YipDirectory::explain(const std::string & path, bool process, const char * reason,
+	const std::string & detail)
+{
+	addExplanation(path, (process ? "process" : "skip"), reason, detail);
+	return process;
+}
+
+void YipDirectory::explainWrite(const std::string & path, bool write, const char * reason)
+{
+	addExplanation(path, (write ? "write" : "keep"), reason, std::string());
+}
+
+void YipDirectory::printExplanation() const
+{
+	std::lock_guard<std::mutex> lock(m_ExplainMutex);
+
+	std::map<std::string, size_t> histogram;
+	for (const auto & it : m_Explanations)
+	{
+		std::cout << "explain: " << it.first << std::endl;
+		for (const Explanation & explanation : it.second)
+		{
+			std::string key = explanation.decision + ": " + explanation.reason;
+			++histogram[key];
+
+			std::cout << "    " << key;
+			if (!explanation.detail.empty())
+				std::cout << " (" << explanation.detail << ')';
+			std::cout << std::endl;
+		}
+	}
+
+	std::vector<std::pair<size_t, std::string>> sorted;
+	for (const auto & it : histogram)
+		sorted.push_back(std::make_pair(it.second, it.first));
+	std::stable_sort(sorted.begin(), sorted.end(), [](const std::pair<size_t, std::string> & a,
+			const std::pair<size_t, std::string> & b) { return a.first > b.first; });
+
+	std::cout << "explain: " << m_Explanations.size() << " file(s), decisions by reason:" << std::endl;
+	for (const auto & it : sorted)
+		std::cout << std::setw(10) << it.first << "  " << it.second << std::endl;
+}
+
+std::string YipDirectory::lockFilePath(const std::string & path) const
+{
+	return pathConcat(pathConcat(m_Path, "locks"), sha1(pathSimplify(path)));
+}
+
+// Paths are stored in the database relative to the .yip directory and to the project directory, so that the
+// database remains valid when the project is moved
+std::string YipDirectory::relativeFilePath(const std::string & file) const
+{
+	return pathRelativeToDirectory(file, m_Path);
+}
+
+std::string YipDirectory::relativeInputPath(const std::string & file) const
+{
+	return pathRelativeToDirectory(file, m_ProjectPath);
+}
+
+// Should be called with the mutex locked
+void YipDirectory::createDirectory(const std::string & dir)
+{
+	if (dir.length() > 0 && m_CreatedDirectories.insert(dir).second)
+		pathCreate(dir);
+}
+
+// Should be called with the mutex locked
+void YipDirectory::replaceFile(const std::string & tempFile, const std::string & file)
+{
+	// rename() atomically replaces the target on POSIX systems, but fails on Windows if the target exists
+  #ifdef _WIN32
+	remove(file.c_str());
+  #endif
+	if (rename(tempFile.c_str(), file.c_str()) != 0)
+	{
+		int err = errno;
+		remove(tempFile.c_str());
+		throw std::runtime_error(fmt() << "unable to rename file '" << tempFile << "' to '"
+			<< file << "': " << strerror(err));
+	}
+
+	m_UnsyncedFiles.push_back(file);
+}
+
+// Written files are synced to the disk all at once before their records are committed to the database, so that
+// the database never refers to the data that could be lost. Should be called with the mutex locked.
+void YipDirectory::syncWrittenFiles()
+{
+	if (m_UnsyncedFiles.empty())
+		return;
+
+	if (!fileSystemSync(m_Path))
+	{
+		std::unordered_set<std::string> dirs;
+		for (const std::string & file : m_UnsyncedFiles)
+		{
+			fileSync(file);
+			dirs.insert(pathGetDirectory(file));
+		}
+		for (const std::string & dir : dirs)
+			fileSync(dir);
+	}
+
+	m_UnsyncedFiles.clear();
+}
+
+bool YipDirectory::restoreCachedFile(const std::string & path, const std::vector<std::string> & inputs,
+	const std::string & settings)
+{
+	if (!m_OutputCache)
+		return false;
+
+	// Key depends on contents of the inputs but not on their location, so that the cache is shared between
+	// checkouts of the project
+	static const char separator = 0;
+	SHA1Context keyContext;
+	keyContext.update(m_GeneratorHash.data(), m_GeneratorHash.length());
+	keyContext.update(&separator, 1);
+	keyContext.update(path.data(), path.length());
+	keyContext.update(&separator, 1);
+	keyContext.update(settings.data(), settings.length());
+	for (const std::string & input : inputs)
+	{
+		if (!cachedPathIsExistent(input))
+			return false;
+
+		std::string hash = fileSHA1(input);
+		keyContext.update(&separator, 1);
+		keyContext.update(hash.data(), hash.length());
+	}
+	std::string key = keyContext.finish();
+
+	std::string target = pathSimplify(pathConcat(m_Path, path));
+	std::string file = target;
+	std::string tempFile = target + ".tmp";
+
+	FileLock fileLock(lockFilePath(path));
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		createDirectory(pathGetDirectory(file));
+	}
+
+	ContentHashContext hashContext;
+	size_t size = 0;
+	bool found;
+	try
+	{
+		found = m_OutputCache->fetch(key, tempFile, hashContext, size);
+	}
+	catch (const std::exception & e)
+	{
+		std::cerr << "warning: unable to read output cache: " << e.what() << std::endl;
+		found = false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	if (!found)
+	{
+		m_CacheKeys[path] = key;
+		return false;
+	}
+
+	std::cout << "restoring " << path << std::endl;
+	addExplanation(path, "restore", "found in output cache", std::string());
+
+	replaceFile(tempFile, file);
+	statCacheInvalidate(target);
+	statCacheInvalidate(file);
+	file = cachedPathMakeCanonical(file);
+
+	setFileInfo(file, size, hashContext.finish());
+	storePendingInputs(path);
+
+	return true;
+}
+
+void YipDirectory::storeCachedFile(const std::string & path, const std::string & file)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	auto it = m_CacheKeys.find(path);
+	if (it == m_CacheKeys.end())
+		return;
+	std::string key = it->second;
+	m_CacheKeys.erase(it);
+	lock.unlock();
 
-	return false;
+	// Generated file is still valid if it could not be stored into the cache
+	try
+	{
+		m_OutputCache->store(key, file);
+	}
+	catch (const std::exception & e)
+	{
+		std::cerr << "warning: unable to update output cache: " << e.what() << std::endl;
+	}
 }
 
 std::string YipDirectory::writeFile(const std::string & path, const std::string & data, bool * changed)
 {
-	std::string file = pathSimplify(pathConcat(m_Path, path));
-	bool has_sha1 = false, write = true;
-	std::string new_sha1;
+	std::string target = pathSimplify(pathConcat(m_Path, path));
+	std::string file = target;
+	bool has_hash = false, write = true;
+	const char * reason = "output file does not exist";
+	std::string new_hash;
 
-	SQLiteTransaction transaction(m_DB);
+	FileLock fileLock(lockFilePath(path));
+	std::unique_lock<std::mutex> lock(m_Mutex);
 
 	// Check whether file has changed
-	if (pathIsExistent(file))
+	if (cachedPathIsExistent(file))
 	{
 		// Canonicalize file path
-		file = pathMakeCanonical(file);
-
-		// Get information about file from the database
-		bool found = false;
-		size_t old_size = 0;
-		time_t old_time = 0;
-		std::string old_sha1;
-		m_DB->select("SELECT size, time, sha1 FROM files WHERE path = ? LIMIT 1", { file },
-			[&found, &old_size, &old_time, &old_sha1](const SQLiteCursor & cursor) {
-				found = true;
-				old_size = cursor.toSizeT(0);
-				old_time = cursor.toTimeT(1);
-				old_sha1 = cursor.toString(2);
-			}
-		);
+		file = cachedPathMakeCanonical(file);
 
 		// Check whether file has been modified
-		if (found && data.size() == old_size)
+		FileInfo * info = findFileInfo(file);
+		if (!info)
+			reason = "no database record";
+		else if (data.size() != info->size)
+			reason = "size has changed";
+		else if (!fileMatchesInfo(file, *info))
+			reason = "output file has been modified";
+		else
 		{
-			if (pathGetModificationTime(file) <= old_time)
+			new_hash = contentHash(data);
+			has_hash = true;
+			if (!info->hash.empty() ? new_hash == info->hash : sha1(data) == info->sha1)
 			{
-				new_sha1 = sha1(data);
-				has_sha1 = true;
-				if (new_sha1 == old_sha1)
-					write = false;
+				write = false;
+				reason = "contents did not change";
 			}
+			else
+				reason = "contents have changed";
 		}
 	}
+	explainWrite(path, write, reason);
 
 	// Do not overwrite file if it did not change
 	if (!write)
@@ -169,10 +666,12 @@ std::string YipDirectory::writeFile(const std::string & path, const std::string
 		if (changed)
 			*changed = false;
 
-		assert(has_sha1);
-		m_DB->exec(fmt() << "REPLACE INTO files (path, size, time, sha1) VALUES (?, " << data.size() << ", "
-			<< time(nullptr) << ", ?)", { file, new_sha1 });
-		transaction.commit();
+		assert(has_hash);
+		setFileInfo(file, data.size(), new_hash);
+		storePendingInputs(path);
+
+		lock.unlock();
+		storeCachedFile(path, file);
 
 		return file;
 	}
@@ -181,26 +680,384 @@ std::string YipDirectory::writeFile(const std::string & path, const std::string
 	if (changed)
 		*changed = true;
 
-	// Calculate SHA1 sum of the file
-	if (!has_sha1)
-		new_sha1 = sha1(data);
+	// Calculate hash of the file
+	if (!has_hash)
+		new_hash = contentHash(data);
 
 	// Create directory for the file
-	std::string dir = pathGetDirectory(file);
-	if (dir.length() > 0)
-		pathCreate(dir);
+	createDirectory(pathGetDirectory(file));
 
-	// Write the file
-	::writeFile(file, data);
+	// Write the file. Data is written into the temporary file first, so that an interrupted run never leaves
+	// a partially written file behind.
+	std::string tempFile = target + ".tmp";
+	try
+	{
+		::writeFile(tempFile, data);
+	}
+	catch (...)
+	{
+		remove(tempFile.c_str());
+		throw;
+	}
+	replaceFile(tempFile, file);
+	statCacheInvalidate(target);
+	statCacheInvalidate(file);
 
 	// Store information about file into the database
-	m_DB->exec(fmt() << "REPLACE INTO files (path, size, time, sha1) VALUES (?, " << data.size() << ", "
-		<< time(nullptr) << ", ?)", { file, new_sha1 });
-	transaction.commit();
+	setFileInfo(file, data.size(), new_hash);
+	storePendingInputs(path);
+
+	lock.unlock();
+	storeCachedFile(path, file);
+
+	return file;
+}
+
+std::string YipDirectory::writeFile(const std::string & path,
+	const std::function<void(const WriteFunc & write)> & generator, bool * changed)
+{
+	std::string target = pathSimplify(pathConcat(m_Path, path));
+	std::string file = target;
+	std::string tempFile = file + ".tmp";
+
+	// Other yip processes could be generating the same file
+	FileLock fileLock(lockFilePath(path));
+
+	// Create directory for the file
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		createDirectory(pathGetDirectory(file));
+	}
+
+	// Generate data into the temporary file, calculating size and hash on the fly. The lock is not held
+	// here, so that multiple files could be generated in parallel.
+	FILE * f = fopen(tempFile.c_str(), "wb");
+	if (!f)
+		throw std::runtime_error(fmt() << "unable to create file '" << tempFile << "': " << strerror(errno));
+
+	ContentHashContext hashContext;
+	size_t size = 0;
+	try
+	{
+		generator([f, &tempFile, &hashContext, &size](const void * data, size_t length) {
+			if (fwrite(data, 1, length, f) != length)
+				throw std::runtime_error(fmt() << "unable to write file '" << tempFile << "': " << strerror(errno));
+			hashContext.update(data, length);
+			size += length;
+		});
+
+		if (fclose(f) != 0)
+		{
+			f = nullptr;
+			throw std::runtime_error(fmt() << "unable to write file '" << tempFile << "': " << strerror(errno));
+		}
+		f = nullptr;
+	}
+	catch (...)
+	{
+		if (f)
+			fclose(f);
+		remove(tempFile.c_str());
+		throw;
+	}
+
+	std::string new_hash = hashContext.finish();
+	const char * reason = "output file does not exist";
+	bool write = true;
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	// Check whether file has changed
+	if (cachedPathIsExistent(file))
+	{
+		// Canonicalize file path
+		file = cachedPathMakeCanonical(file);
+
+		// Check whether file has been modified
+		FileInfo * info = findFileInfo(file);
+		if (!info)
+			reason = "no database record";
+		else if (size != info->size)
+			reason = "size has changed";
+		else if (!fileMatchesInfo(file, *info))
+			reason = "output file has been modified";
+		else
+		{
+			if (!info->hash.empty())
+				write = (new_hash != info->hash);
+			else
+			{
+				// File has been written by an older version of yip that only stored SHA1 sum
+				SHA1Context sha1Context;
+				hashFileContents(tempFile, sha1Context);
+				write = (sha1Context.finish() != info->sha1);
+			}
+			reason = (write ? "contents have changed" : "contents did not change");
+		}
+	}
+	explainWrite(path, write, reason);
+
+	if (!write)
+	{
+		std::cout << "keeping " << path << std::endl;
+		if (changed)
+			*changed = false;
+		remove(tempFile.c_str());
+	}
+	else
+	{
+		std::cout << "writing " << path << std::endl;
+		if (changed)
+			*changed = true;
+
+		// Replace the file with the generated one
+		replaceFile(tempFile, file);
+		statCacheInvalidate(target);
+		statCacheInvalidate(file);
+		file = cachedPathMakeCanonical(file);
+	}
+
+	// Store information about file into the database
+	setFileInfo(file, size, new_hash);
+	storePendingInputs(path);
+
+	lock.unlock();
+	storeCachedFile(path, file);
 
 	return file;
 }
 
+std::string YipDirectory::fileSHA1(const std::string & path)
+{
+	std::string file = cachedPathMakeCanonical(path);
+
+	FileStat st;
+	if (!cachedFileStat(file, st))
+		throw std::runtime_error(fmt() << "unable to stat file '" << file << "'.");
+
+	// Use cached value if file did not change since it was hashed
+	bool found = false;
+	std::string old_sha1;
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	auto it = m_DirtyHashes.find(file);
+	if (it != m_DirtyHashes.end() && it->second.stat.size == st.size
+			&& it->second.stat.modificationTimeNs == st.modificationTimeNs && it->second.stat.inode == st.inode)
+		return it->second.sha1;
+	m_DB->select("SELECT sha1 FROM file_hashes WHERE path = ? AND size = ? AND time = ? AND inode = ? LIMIT 1",
+		{ file, fmt() << st.size, fmt() << st.modificationTimeNs, fmt() << st.inode },
+		[&found, &old_sha1](const SQLiteCursor & cursor) {
+			found = true;
+			old_sha1 = cursor.toString(0);
+		}
+	);
+	lock.unlock();
+	if (found)
+		return old_sha1;
+
+	// Calculate SHA1 sum of the file
+	SHA1Context sha1Context;
+	hashFileContents(file, sha1Context);
+
+	std::string new_sha1 = sha1Context.finish();
+	lock.lock();
+	FileHash & hash = m_DirtyHashes[file];
+	hash.stat = st;
+	hash.sha1 = new_sha1;
+
+	return new_sha1;
+}
+
+void YipDirectory::flush()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	syncWrittenFiles();
+	if (m_DirtyFiles.empty() && m_DirtyHashes.empty() && m_DirtyInputs.empty() && m_DirtyDirectories.empty())
+		return;
+
+	SQLiteTransaction transaction(m_DB);
+
+	// Statements below are prepared once and reused for every row, so values are bound rather than formatted
+
+	for (const std::string & file : m_DirtyFiles)
+	{
+		const FileInfo & info = m_Files[file];
+		m_DB->exec("REPLACE INTO files (path, size, time, mtime, used, hash, sha1) VALUES (?, ?, ?, ?, ?, ?, ?)",
+			{ relativeFilePath(file), fmt() << info.size, fmt() << info.time, fmt() << info.mtime, fmt() << info.used,
+				info.hash, info.sha1 });
+	}
+
+	for (const auto & it : m_DirtyHashes)
+	{
+		const FileStat & st = it.second.stat;
+		m_DB->exec("REPLACE INTO file_hashes (path, size, time, inode, sha1) VALUES (?, ?, ?, ?, ?)",
+			{ it.first, fmt() << st.size, fmt() << st.modificationTimeNs, fmt() << st.inode, it.second.sha1 });
+	}
+
+	for (const auto & it : m_DirtyInputs)
+	{
+		for (const auto & input : it.second)
+		{
+			m_DB->exec("REPLACE INTO file_inputs (path, source, sha1) VALUES (?, ?, ?)",
+				{ it.first, input.first, input.second });
+		}
+	}
+
+	for (const auto & it : m_DirtyDirectories)
+	{
+		BinaryWriter writer;
+		writer.writeUInt32(static_cast<uint32_t>(it.second.entries.size()));
+		for (const DirEntry & entry : it.second.entries)
+		{
+			writer.writeString(entry.name);
+			writer.writeBool(entry.type == DirEntry_Directory);
+		}
+
+		m_DB->exec("REPLACE INTO directories (path, time, entries) VALUES (?, ?, ?)",
+			{ it.first, fmt() << it.second.time, writer.data() });
+	}
+
+	transaction.commit();
+
+	m_DirtyFiles.clear();
+	m_DirtyHashes.clear();
+	m_DirtyInputs.clear();
+	m_DirtyDirectories.clear();
+}
+
+// Deletes generated files that were not used by any run for the specified number of days. Only files recorded
+// in the database are considered, so the directory tree is never walked.
+YipDirectory::GarbageStats YipDirectory::collectGarbage(unsigned maxAgeDays, bool compact)
+{
+	GarbageStats stats;
+	stats.numFiles = 0;
+	stats.bytesFreed = 0;
+
+	// Usage times of this run should be visible to the query below
+	flush();
+
+	std::vector<std::string> files;
+	time_t cutoff = time(nullptr) - static_cast<time_t>(maxAgeDays) * 86400;
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_DB->select("SELECT path FROM files WHERE used < ?", { fmt() << cutoff },
+		[this, &files](const SQLiteCursor & cursor) {
+			files.push_back(pathMakeAbsolute(cursor.toString(0), m_Path));
+		}
+	);
+	lock.unlock();
+
+	std::string prefix = m_Path + '/';
+	std::vector<std::string> removed;
+	for (const std::string & file : files)
+	{
+		// Never touch anything outside of the .yip directory
+		if (file.compare(0, prefix.length(), prefix) != 0)
+			continue;
+
+		std::string path = file.substr(prefix.length());
+		FileLock fileLock(lockFilePath(path));
+
+		// Another process could have used the file after the query above. Files it has written but not yet
+		// recorded in the database are recognized by the modification time.
+		bool unused = false;
+		long long mtime = 0;
+		lock.lock();
+		m_DB->select("SELECT used, mtime FROM files WHERE path = ?", { relativeFilePath(file) },
+			[cutoff, &unused, &mtime](const SQLiteCursor & cursor) {
+				unused = (cursor.toTimeT(0) < cutoff);
+				mtime = static_cast<long long>(cursor.toInt64(1));
+			}
+		);
+		lock.unlock();
+		if (!unused)
+			continue;
+
+		FileStat st;
+		bool exists = fileStat(file, st);
+		if (exists && mtime != 0 && st.modificationTimeNs != mtime)
+			continue;
+
+		if (exists)
+		{
+			if (remove(file.c_str()) != 0)
+			{
+				std::cerr << "warning: unable to delete file '" << file << "': " << strerror(errno) << std::endl;
+				continue;
+			}
+			statCacheInvalidate(file);
+			std::cout << "killing " << path << std::endl;
+			stats.bytesFreed += st.size;
+		}
+
+		fileLock.removeFile();
+		removed.push_back(file);
+	}
+
+	lock.lock();
+
+	SQLiteTransaction transaction(m_DB);
+	for (const std::string & file : removed)
+	{
+		m_DB->exec("DELETE FROM files WHERE path = ?", { relativeFilePath(file) });
+		m_DB->exec("DELETE FROM file_inputs WHERE path = ?", { file.substr(prefix.length()) });
+		m_Inputs.erase(file.substr(prefix.length()));
+		m_Files.erase(file);
+	}
+	transaction.commit();
+	stats.numFiles = removed.size();
+
+	if (!compact)
+		return stats;
+
+	// Forget hashes of the files that no longer exist
+	std::vector<std::string> hashes;
+	m_DB->select("SELECT path FROM file_hashes", [&hashes](const SQLiteCursor & cursor) {
+		hashes.push_back(cursor.toString(0));
+	});
+	SQLiteTransaction hashesTransaction(m_DB);
+	for (const std::string & file : hashes)
+	{
+		if (!pathIsExistent(file))
+			m_DB->exec("DELETE FROM file_hashes WHERE path = ?", { file });
+	}
+	hashesTransaction.commit();
+
+	// Forget listings of the directories that no longer exist
+	std::vector<std::string> dirs;
+	m_DB->select("SELECT path FROM directories", [&dirs](const SQLiteCursor & cursor) {
+		dirs.push_back(cursor.toString(0));
+	});
+	SQLiteTransaction dirsTransaction(m_DB);
+	for (const std::string & dir : dirs)
+	{
+		if (!pathIsExistent(pathMakeAbsolute(dir, m_ProjectPath)))
+			m_DB->exec("DELETE FROM directories WHERE path = ?", { dir });
+	}
+	dirsTransaction.commit();
+
+	// Delete lock files left by files that are no longer generated. Lock files are deleted with the lock held,
+	// so that processes waiting for the lock switch to a new file.
+	std::string locksDir = pathConcat(m_Path, "locks");
+	for (const DirEntry & entry : pathEnumDirectoryContents(locksDir))
+	{
+		if (entry.type != DirEntry_File)
+			continue;
+		FileLock fileLock(pathConcat(locksDir, entry.name));
+		fileLock.removeFile();
+	}
+
+	// Rebuild the database file, dropping free pages
+	std::string dbFile = pathConcat(m_Path, "db");
+	FileStat before, after;
+	m_DB->queryString("PRAGMA wal_checkpoint(TRUNCATE)");
+	bool hasSize = fileStat(dbFile, before);
+	m_DB->exec("VACUUM");
+	m_DB->queryString("PRAGMA wal_checkpoint(TRUNCATE)");
+	if (hasSize && fileStat(dbFile, after) && after.size < before.size)
+		stats.bytesFreed += before.size - after.size;
+
+	return stats;
+}
+
 std::string YipDirectory::writeIncludeWrapper(const std::string & name, const std::string & originalIncludePath)
 {
 	std::stringstream ss;
@@ -208,6 +1065,75 @@ std::string YipDirectory::writeIncludeWrapper(const std::string & name, const st
 	return writeFile(name, ss.str());
 }
 
+DirectoryScanner::Result YipDirectory::scanDirectory(const std::string & path, size_t maxDepth,
+	const DirectoryScanner::Filter & filter)
+{
+	DirectoryScanner scanner(this, g_Config->jobs);
+	return scanner.scan(path, maxDepth, filter);
+}
+
+bool YipDirectory::lookupDirectory(const std::string & path, long long modificationTimeNs, DirEntryList & list)
+{
+	std::string dir = relativeInputPath(path);
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	auto it = m_DirtyDirectories.find(dir);
+	if (it != m_DirtyDirectories.end())
+	{
+		if (it->second.time != modificationTimeNs)
+			return false;
+		list = it->second.entries;
+		return true;
+	}
+
+	bool found = false;
+	std::string entries;
+	m_DB->select("SELECT entries FROM directories WHERE path = ? AND time = ? LIMIT 1",
+		{ dir, fmt() << modificationTimeNs },
+		[&found, &entries](const SQLiteCursor & cursor) {
+			found = true;
+			entries = cursor.toString(0);
+		}
+	);
+	lock.unlock();
+	if (!found)
+		return false;
+
+	// Damaged records are ignored, so the directory is read again
+	try
+	{
+		BinaryReader reader(entries);
+		uint32_t count = reader.readUInt32();
+		list.clear();
+		list.reserve(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			DirEntry entry;
+			entry.name = reader.readString();
+			entry.type = (reader.readBool() ? DirEntry_Directory : DirEntry_File);
+			list.push_back(std::move(entry));
+		}
+	}
+	catch (const std::exception &)
+	{
+		list.clear();
+		return false;
+	}
+
+	return true;
+}
+
+void YipDirectory::storeDirectory(const std::string & path, long long modificationTimeNs,
+	const DirEntryList & list)
+{
+	std::string dir = relativeInputPath(path);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	DirectoryListing & listing = m_DirtyDirectories[dir];
+	listing.time = modificationTimeNs;
+	listing.entries = list;
+}
+
 std::string YipDirectory::getGitRepositoryPath(const std::string & url)
 {
 	return pathConcat(m_Path, "git-" + sha1(url).substr(1, 10));
@@ -237,7 +1163,7 @@ void YipDirectory::initDB()
 	m_DB->exec("CREATE TABLE IF NOT EXISTS did_build_tizen (id INTEGER PRIMARY KEY, value INTEGER);");
 	m_DB->exec("CREATE TABLE IF NOT EXISTS project_dir (id INTEGER PRIMARY KEY, path TEXT);");
 	m_DB->exec("CREATE TABLE IF NOT EXISTS files (path TEXT PRIMARY KEY, size INTEGER, "
-		"time INTEGER, sha1 TEXT);");
+		"time INTEGER, mtime INTEGER DEFAULT 0, used INTEGER DEFAULT 0, hash TEXT DEFAULT '', sha1 TEXT);");
 
 	SQLiteTransaction transaction(m_DB);
 
@@ -249,22 +1175,71 @@ void YipDirectory::initDB()
 			<< " is not supported (maximum supported version is " << DATABASE_VERSION << ").");
 	}
 
+	// Version 2 stores nanosecond modification time and inode of hashed files
+	if (version < 2)
+		m_DB->exec("DROP TABLE IF EXISTS file_hashes");
+
+	// Version 3 stores modification time of the written files
+	if (!tableHasColumn(m_DB, "files", "mtime"))
+		m_DB->exec("ALTER TABLE files ADD COLUMN mtime INTEGER DEFAULT 0");
+
+	// Version 4 stores last usage time of the written files. Existing files are considered used now.
+	if (!tableHasColumn(m_DB, "files", "used"))
+	{
+		m_DB->exec("ALTER TABLE files ADD COLUMN used INTEGER DEFAULT 0");
+		m_DB->exec("UPDATE files SET used = ?", { fmt() << time(nullptr) });
+	}
+	m_DB->exec("CREATE INDEX IF NOT EXISTS files_used ON files (used)");
+
+	// Version 5 stores content hash of the written files. SHA1 sums of existing files are kept, so that they
+	// are not rewritten: the first run compares them by SHA1 and replaces the sum with the content hash.
+	if (!tableHasColumn(m_DB, "files", "hash"))
+		m_DB->exec("ALTER TABLE files ADD COLUMN hash TEXT DEFAULT ''");
+
+	m_DB->exec("CREATE TABLE IF NOT EXISTS file_hashes (path TEXT PRIMARY KEY, size INTEGER, "
+		"time INTEGER, inode INTEGER, sha1 TEXT);");
+	m_DB->exec("CREATE TABLE IF NOT EXISTS file_inputs (path TEXT, source TEXT, sha1 TEXT, "
+		"PRIMARY KEY (path, source));");
+	m_DB->exec("CREATE TABLE IF NOT EXISTS directories (path TEXT PRIMARY KEY, time INTEGER, entries TEXT);");
+
+	// Version 6 stores paths relative to the .yip directory and to the project directory
+	std::string projectDir = m_DB->queryString("SELECT path FROM project_dir WHERE id = 1 LIMIT 1");
+	if (version != 0 && version < 6 && projectDir.length() != 0)
+		makeStoredPathsRelative(m_DB, projectDir);
+
 	// Update database version
 	m_DB->exec(fmt() << "REPLACE INTO version (id, value) VALUES (1, " << DATABASE_VERSION << ")");
 
 	if (version != 0 && version != DATABASE_VERSION)
 		std::cout << "notice: database has been updated to version " << DATABASE_VERSION << '.' << std::endl;
 
-	// Check whether project directory has changed
-	std::string projectDir = m_DB->queryString("SELECT path FROM project_dir WHERE id = 1 LIMIT 1");
+	// Check whether project directory has changed. Stored paths are relative, so records remain valid.
 	if (projectDir.length() == 0)
 		m_DB->exec("REPLACE INTO project_dir (id, path) VALUES (1, ?)", { m_Path });
 	else if (projectDir != m_Path)
 	{
-		std::cout << "notice: project directory has changed - resyncing." << std::endl;
-		m_DB->exec("DELETE FROM files");
+		std::cout << "notice: project directory has moved - rebasing." << std::endl;
 		m_DB->exec("REPLACE INTO project_dir (id, path) VALUES (1, ?)", { m_Path });
 	}
 
 	transaction.commit();
+
+	loadFiles();
+}
+
+void YipDirectory::loadFiles()
+{
+	m_DB->select("SELECT path, size, time, mtime, used, hash, sha1 FROM files", [this](const SQLiteCursor & cursor) {
+		FileInfo & info = m_Files[pathMakeAbsolute(cursor.toString(0), m_Path)];
+		info.size = cursor.toSizeT(1);
+		info.time = cursor.toTimeT(2);
+		info.mtime = cursor.toInt64(3);
+		info.used = cursor.toTimeT(4);
+		info.hash = cursor.toString(5);
+		info.sha1 = cursor.toString(6);
+	});
+
+	m_DB->select("SELECT path, source, sha1 FROM file_inputs", [this](const SQLiteCursor & cursor) {
+		m_Inputs[cursor.toString(0)][cursor.toString(1)] = cursor.toString(2);
+	});
 }
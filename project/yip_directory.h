@@ -25,20 +25,45 @@
 
 #include "../util/git.h"
 #include "../util/sqlite.h"
+#include "../util/file_stat.h"
+#include "../util/file_cache.h"
+#include "../util/directory_scanner.h"
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <vector>
 
 class Project;
 
-class YipDirectory
+class YipDirectory : private DirectoryScanner::Cache
 {
 public:
+	typedef std::function<void(const void * data, size_t size)> WriteFunc;
+
+	struct GarbageStats
+	{
+		size_t numFiles;
+		unsigned long long bytesFreed;
+	};
+
 	YipDirectory(const std::string & projectPath, const Project * project);
 	~YipDirectory();
 
 	inline const std::string & path() const { return m_Path; }
 	inline const Project * project() const { return m_Project; }
 
+	// SHA1 of the yip executable
+	inline const std::string & generatorHash() const { return m_GeneratorHash; }
+
+	// When enabled, reasons of all decisions made by shouldProcessFile and writeFile are recorded
+	void setExplain(bool flag) { m_Explain = flag; }
+	void printExplanation() const;
+
 	bool didBuildIOS() const;
 	void setDidBuildIOS();
 
@@ -51,20 +76,121 @@ public:
 	bool shouldProcessFile(const std::string & path, const std::string & sourcePath,
 		bool rebuildIfProjectFileChanged);
 
+	// Same as above, but the file is rebuilt only if one of the specified project files has been changed
+	bool shouldProcessFile(const std::string & path, const std::string & sourcePath,
+		const std::set<std::string> & projectFiles);
+
+	// Restores the file from the output cache if it contains a file generated from the same inputs. Otherwise
+	// the file is stored into the cache when it is written. Settings should describe everything else the
+	// contents of the file depend on.
+	bool restoreCachedFile(const std::string & path, const std::vector<std::string> & inputs,
+		const std::string & settings = std::string());
+
 	std::string writeFile(const std::string & path, const std::string & data, bool * changed = nullptr);
+	std::string writeFile(const std::string & path, const std::function<void(const WriteFunc & write)> & generator,
+		bool * changed = nullptr);
+	std::string fileSHA1(const std::string & path);
+
+	// Path of the lock file that serializes generation of the given file between yip processes
+	std::string lockFilePath(const std::string & path) const;
+
+	void flush();
+	GarbageStats collectGarbage(unsigned maxAgeDays, bool compact);
+
 	std::string writeIncludeWrapper(const std::string & name, const std::string & originalIncludePath);
 
+	// Listings of directories that did not change since the previous run are taken from the database
+	DirectoryScanner::Result scanDirectory(const std::string & path, size_t maxDepth = SIZE_MAX,
+		const DirectoryScanner::Filter & filter = DirectoryScanner::Filter());
+
 	std::string getGitRepositoryPath(const std::string & url);
 	GitRepositoryPtr openGitRepository(const std::string & url, GitProgressPrinter * printer);
 	GitRepositoryPtr openGitRepository(const std::string & url, GitProgressPrinter && prn = GitProgressPrinter())
 		{ return openGitRepository(url, &prn); }
 
 private:
+	struct FileInfo
+	{
+		size_t size;
+		time_t time;
+		long long mtime;		// Modification time of the written file in nanoseconds (0 if unknown)
+		time_t used;			// Last time the file was written or found up to date
+		std::string hash;		// Content hash of the file (empty if file was written by an older version)
+		std::string sha1;		// SHA1 sum stored by older versions (empty if hash is known)
+	};
+
+	struct Explanation
+	{
+		std::string decision;
+		std::string reason;
+		std::string detail;
+	};
+
+	struct FileHash
+	{
+		FileStat stat;
+		std::string sha1;
+	};
+
+	struct DirectoryListing
+	{
+		long long time;			// Modification time of the directory in nanoseconds
+		DirEntryList entries;
+	};
+
 	std::string m_Path;
+	std::string m_ProjectPath;
 	const Project * m_Project;
 	SQLiteDatabasePtr m_DB;
+	mutable std::mutex m_Mutex;	// Serializes access to the database from worker threads
+	bool m_CompareContents;
+	bool m_Explain;
+	mutable std::mutex m_ExplainMutex;
+	std::map<std::string, std::vector<Explanation>> m_Explanations;
+	std::unordered_map<std::string, std::map<std::string, std::string>> m_PendingInputs;
+
+	// Contents of the 'files' and 'file_inputs' tables are kept in memory. Changes are written into the database
+	// in a single transaction by flush(), so an interrupted run only loses records of the files it has written.
+	std::unordered_map<std::string, FileInfo> m_Files;
+	std::unordered_map<std::string, std::map<std::string, std::string>> m_Inputs;	// Hashes of inputs by output
+	std::unordered_set<std::string> m_DirtyFiles;
+	std::unordered_map<std::string, FileHash> m_DirtyHashes;
+	std::unordered_map<std::string, std::map<std::string, std::string>> m_DirtyInputs;
+	std::unordered_map<std::string, DirectoryListing> m_DirtyDirectories;
+	std::vector<std::string> m_UnsyncedFiles;			// Written files that should be synced before flush
+	std::unordered_set<std::string> m_CreatedDirectories;
+	std::unique_ptr<FileCache> m_OutputCache;
+	std::string m_GeneratorHash;
+	std::unordered_map<std::string, std::string> m_CacheKeys;	// Keys of the files to store into the cache
+
+	FileInfo * findFileInfo(const std::string & file);
+	bool markFileUsed(const std::string & file, FileInfo & info);
+	bool keepFile(const std::string & path, const std::string & file);
+	void setFileInfo(const std::string & file, size_t size, const std::string & hash);
+	bool fileMatchesInfo(const std::string & file, FileInfo & info);
+	void addExplanation(const std::string & path, const char * decision, const char * reason,
+		const std::string & detail);
+	bool explain(const std::string & path, bool process, const char * reason,
+		const std::string & detail = std::string());
+	void explainWrite(const std::string & path, bool write, const char * reason);
+	std::string relativeFilePath(const std::string & file) const;
+	std::string relativeInputPath(const std::string & file) const;
+	void createDirectory(const std::string & dir);
+	void replaceFile(const std::string & tempFile, const std::string & file);
+	void syncWrittenFiles();
+	void storeCachedFile(const std::string & path, const std::string & file);
+
+	bool shouldProcessFileByContents(const std::string & path, const std::string & sourcePath,
+		const std::set<std::string> & projectFiles);
+	bool inputHasChanged(const std::string & path, const std::string & sourcePath);
+	void storePendingInputs(const std::string & path);
+
+	bool lookupDirectory(const std::string & path, long long modificationTimeNs, DirEntryList & list) override;
+	void storeDirectory(const std::string & path, long long modificationTimeNs,
+		const DirEntryList & list) override;
 
 	void initDB();
+	void loadFiles();
 
 	YipDirectory(const YipDirectory &) = delete;
 	YipDirectory & operator=(const YipDirectory &) = delete;
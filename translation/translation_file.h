@@ -36,6 +36,8 @@ public:
 	TranslationFile(Project * prj, const std::string & lang, const std::string & name, const std::string & path);
 	inline ~TranslationFile() {}
 
+	inline const std::string & language() const { return m_Language; }
+	inline const std::string & name() const { return m_Name; }
 	inline const std::string & path() const { return m_Path; }
 
 	void parse();
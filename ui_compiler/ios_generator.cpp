@@ -38,6 +38,7 @@
 #include "../util/path-util/path-util.h"
 #include "../util/cxx_escape.h"
 #include <cassert>
+#include <set>
 #include <stdexcept>
 
 std::string iosScaleFunc(UIScaleMode mode, bool horz)
@@ -1020,25 +1021,58 @@ void uiGenerateIOSViewController(UILayoutMap & layouts, const ProjectPtr & proje
 	std::string targetPathH = pathConcat(".yip-ios-view-controllers/yip-ios", targetName) + ".h";
 	std::string targetPathM = pathConcat(".yip-ios-view-controllers/yip-ios", targetName) + ".mm";
 
-	bool shouldProcessFile =
-		(cntrl.iphone.get() && (
-			project->yipDirectory()->shouldProcessFile(targetPathH, cntrl.iphone->path(), true) ||
-			project->yipDirectory()->shouldProcessFile(targetPathM, cntrl.iphone->path(), true))) ||
-		(cntrl.ipad.get() && (
-			project->yipDirectory()->shouldProcessFile(targetPathH, cntrl.ipad->path(), true) ||
-			project->yipDirectory()->shouldProcessFile(targetPathM, cntrl.ipad->path(), true)));
+	// Generated files depend only on the project file declaring the view controller and on project files
+	// declaring translations, so that changes to unrelated fragments of the project do not invalidate them
+	std::set<std::string> projectFiles = project->translationProjectFiles();
+	if (!cntrl.projectFile.empty())
+		projectFiles.insert(cntrl.projectFile);
+	else
+		projectFiles.insert(project->projectFiles().begin(), project->projectFiles().end());
 
-	if (!shouldProcessFile)
+	// Every input is checked even after a changed one has been found: in the content mode the check also
+	// records hash of the input, which is stored when the output file is written
+	YipDirectory * yipDirectory = project->yipDirectory().get();
+	bool shouldProcessFile = false;
+	if (cntrl.iphone.get())
+	{
+		bool changedH = yipDirectory->shouldProcessFile(targetPathH, cntrl.iphone->path(), projectFiles);
+		bool changedM = yipDirectory->shouldProcessFile(targetPathM, cntrl.iphone->path(), projectFiles);
+		shouldProcessFile = shouldProcessFile || changedH || changedM;
+	}
+	if (cntrl.ipad.get())
+	{
+		bool changedH = yipDirectory->shouldProcessFile(targetPathH, cntrl.ipad->path(), projectFiles);
+		bool changedM = yipDirectory->shouldProcessFile(targetPathM, cntrl.ipad->path(), projectFiles);
+		shouldProcessFile = shouldProcessFile || changedH || changedM;
+	}
+	for (auto it : project->translationFiles())
+	{
+		bool changedH = yipDirectory->shouldProcessFile(targetPathH, it.second->path(), false);
+		bool changedM = yipDirectory->shouldProcessFile(targetPathM, it.second->path(), false);
+		shouldProcessFile = shouldProcessFile || changedH || changedM;
+	}
+
+	// Generated files depend on the layouts, translations and the project files
+	if (shouldProcessFile)
 	{
+		std::vector<std::string> inputs;
+		if (cntrl.iphone.get())
+			inputs.push_back(cntrl.iphone->path());
+		if (cntrl.ipad.get())
+			inputs.push_back(cntrl.ipad->path());
 		for (auto it : project->translationFiles())
-		{
-			if (project->yipDirectory()->shouldProcessFile(targetPathH, it.second->path(), false) ||
-				project->yipDirectory()->shouldProcessFile(targetPathM, it.second->path(), false))
-			{
-				shouldProcessFile = true;
-				break;
-			}
-		}
+			inputs.push_back(it.second->path());
+		for (const std::string & projectFile : projectFiles)
+			inputs.push_back(projectFile);
+
+		std::string settings = fmt() << "iphone=" << (cntrl.iphone.get() != nullptr)
+			<< " ipad=" << (cntrl.ipad.get() != nullptr);
+
+		// Both files are looked up, so that both are stored into the cache when generated
+		bool restoredH = project->yipDirectory()->restoreCachedFile(targetPathH, inputs, settings);
+		bool restoredM = project->yipDirectory()->restoreCachedFile(targetPathM, inputs, settings);
+		if (restoredH && restoredM)
+			shouldProcessFile = false;
 	}
 
 	if (!shouldProcessFile)
@@ -0,0 +1,95 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "binary_stream.h"
+#include <stdexcept>
+
+/* BinaryWriter */
+
+BinaryWriter::BinaryWriter()
+{
+}
+
+void BinaryWriter::writeUInt32(uint32_t value)
+{
+	for (int i = 0; i < 4; i++, value >>= 8)
+		m_Data += static_cast<char>(value & 0xFF);
+}
+
+void BinaryWriter::writeUInt64(uint64_t value)
+{
+	for (int i = 0; i < 8; i++, value >>= 8)
+		m_Data += static_cast<char>(value & 0xFF);
+}
+
+void BinaryWriter::writeString(const std::string & value)
+{
+	writeUInt32(static_cast<uint32_t>(value.length()));
+	m_Data += value;
+}
+
+/* BinaryReader */
+
+BinaryReader::BinaryReader(const std::string & data)
+	: m_Data(data),
+	  m_Offset(0)
+{
+}
+
+uint32_t BinaryReader::readUInt32()
+{
+	const unsigned char * p = read(4);
+	uint32_t value = 0;
+	for (int i = 3; i >= 0; i--)
+		value = (value << 8) | p[i];
+	return value;
+}
+
+uint64_t BinaryReader::readUInt64()
+{
+	const unsigned char * p = read(8);
+	uint64_t value = 0;
+	for (int i = 7; i >= 0; i--)
+		value = (value << 8) | p[i];
+	return value;
+}
+
+bool BinaryReader::readBool()
+{
+	return *read(1) != 0;
+}
+
+std::string BinaryReader::readString()
+{
+	size_t length = readUInt32();
+	return std::string(reinterpret_cast<const char *>(read(length)), length);
+}
+
+const unsigned char * BinaryReader::read(size_t size)
+{
+	if (size > m_Data.length() - m_Offset)
+		throw std::runtime_error("unexpected end of data.");
+
+	const unsigned char * p = reinterpret_cast<const unsigned char *>(m_Data.data()) + m_Offset;
+	m_Offset += size;
+	return p;
+}
@@ -0,0 +1,74 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __33245613822942aa8bc510735d474cd0__
+#define __33245613822942aa8bc510735d474cd0__
+
+#include <cstdint>
+#include <string>
+
+// Little endian binary serialization
+class BinaryWriter
+{
+public:
+	BinaryWriter();
+
+	inline const std::string & data() const { return m_Data; }
+
+	void writeUInt32(uint32_t value);
+	void writeUInt64(uint64_t value);
+	inline void writeInt64(int64_t value) { writeUInt64(static_cast<uint64_t>(value)); }
+	inline void writeBool(bool value) { m_Data += (value ? '\1' : '\0'); }
+	void writeString(const std::string & value);
+
+private:
+	std::string m_Data;
+
+	BinaryWriter(const BinaryWriter &) = delete;
+	BinaryWriter & operator=(const BinaryWriter &) = delete;
+};
+
+// Reads data written by BinaryWriter. Throws exception if data is truncated.
+class BinaryReader
+{
+public:
+	BinaryReader(const std::string & data);
+
+	inline bool atEnd() const { return m_Offset == m_Data.length(); }
+
+	uint32_t readUInt32();
+	uint64_t readUInt64();
+	inline int64_t readInt64() { return static_cast<int64_t>(readUInt64()); }
+	bool readBool();
+	std::string readString();
+
+private:
+	const std::string & m_Data;
+	size_t m_Offset;
+
+	const unsigned char * read(size_t size);
+
+	BinaryReader(const BinaryReader &) = delete;
+	BinaryReader & operator=(const BinaryReader &) = delete;
+};
+
+#endif
@@ -0,0 +1,245 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "content_hash.h"
+#include <cstring>
+
+// Round and merge functions of the first set of lanes are the ones of XXH64
+
+static const uint64_t PRIME1 = 11400714785074694791ULL;
+static const uint64_t PRIME2 = 14029467366897019727ULL;
+static const uint64_t PRIME3 = 1609587929392839161ULL;
+static const uint64_t PRIME4 = 9650029242287828579ULL;
+static const uint64_t PRIME5 = 2870177450012600261ULL;
+
+static inline uint64_t rotl(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+// Input is read as little endian, so that hashes do not depend on the host
+static inline uint64_t read64(const unsigned char * p)
+{
+	return static_cast<uint64_t>(p[0])
+		| (static_cast<uint64_t>(p[1]) << 8)
+		| (static_cast<uint64_t>(p[2]) << 16)
+		| (static_cast<uint64_t>(p[3]) << 24)
+		| (static_cast<uint64_t>(p[4]) << 32)
+		| (static_cast<uint64_t>(p[5]) << 40)
+		| (static_cast<uint64_t>(p[6]) << 48)
+		| (static_cast<uint64_t>(p[7]) << 56);
+}
+
+static inline uint64_t read32(const unsigned char * p)
+{
+	return static_cast<uint64_t>(p[0])
+		| (static_cast<uint64_t>(p[1]) << 8)
+		| (static_cast<uint64_t>(p[2]) << 16)
+		| (static_cast<uint64_t>(p[3]) << 24);
+}
+
+static inline uint64_t round(uint64_t acc, uint64_t input)
+{
+	acc += input * PRIME2;
+	acc = rotl(acc, 31);
+	return acc * PRIME1;
+}
+
+static inline uint64_t mergeRound(uint64_t acc, uint64_t value)
+{
+	acc ^= round(0, value);
+	return acc * PRIME1 + PRIME4;
+}
+
+// Round of the second set of lanes. Each lane also consumes the adjacent word of the stripe, so that a change
+// of a single word affects two lanes of this set.
+static inline uint64_t round2(uint64_t acc, uint64_t input, uint64_t adjacent)
+{
+	acc += (input ^ rotl(adjacent, 32)) * PRIME4;
+	acc = rotl(acc, 29);
+	return acc * PRIME3;
+}
+
+static inline uint64_t mergeRound2(uint64_t acc, uint64_t value)
+{
+	acc ^= round2(0, value, 0);
+	return acc * PRIME3 + PRIME5;
+}
+
+static inline uint64_t avalanche(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= PRIME2;
+	h ^= h >> 29;
+	h *= PRIME3;
+	h ^= h >> 32;
+	return h;
+}
+
+static void appendHex(std::string & str, uint64_t value)
+{
+	const char * hex = "0123456789abcdef";
+	for (int shift = 60; shift >= 0; shift -= 4)
+		str += hex[(value >> shift) & 0xF];
+}
+
+/* ContentHashContext */
+
+ContentHashContext::ContentHashContext()
+	: m_BufferSize(0),
+	  m_TotalSize(0)
+{
+	m_Lanes[0] = PRIME1 + PRIME2;
+	m_Lanes[1] = PRIME2;
+	m_Lanes[2] = 0;
+	m_Lanes[3] = 0 - PRIME1;
+	m_Lanes2[0] = PRIME3 + PRIME4;
+	m_Lanes2[1] = PRIME4;
+	m_Lanes2[2] = PRIME5;
+	m_Lanes2[3] = 0 - PRIME3;
+}
+
+void ContentHashContext::processStripe(const unsigned char * p)
+{
+	uint64_t w1 = read64(p), w2 = read64(p + 8), w3 = read64(p + 16), w4 = read64(p + 24);
+	m_Lanes[0] = round(m_Lanes[0], w1);
+	m_Lanes[1] = round(m_Lanes[1], w2);
+	m_Lanes[2] = round(m_Lanes[2], w3);
+	m_Lanes[3] = round(m_Lanes[3], w4);
+	m_Lanes2[0] = round2(m_Lanes2[0], w1, w2);
+	m_Lanes2[1] = round2(m_Lanes2[1], w2, w3);
+	m_Lanes2[2] = round2(m_Lanes2[2], w3, w4);
+	m_Lanes2[3] = round2(m_Lanes2[3], w4, w1);
+}
+
+void ContentHashContext::update(const void * data, size_t size)
+{
+	const unsigned char * p = static_cast<const unsigned char *>(data);
+	m_TotalSize += size;
+
+	if (m_BufferSize > 0)
+	{
+		size_t length = sizeof(m_Buffer) - m_BufferSize;
+		if (size < length)
+		{
+			memcpy(m_Buffer + m_BufferSize, p, size);
+			m_BufferSize += size;
+			return;
+		}
+
+		memcpy(m_Buffer + m_BufferSize, p, length);
+		processStripe(m_Buffer);
+		m_BufferSize = 0;
+		p += length;
+		size -= length;
+	}
+
+	// Lanes are kept in local variables, so that they stay in registers in the hot loop
+	uint64_t v1 = m_Lanes[0], v2 = m_Lanes[1], v3 = m_Lanes[2], v4 = m_Lanes[3];
+	uint64_t u1 = m_Lanes2[0], u2 = m_Lanes2[1], u3 = m_Lanes2[2], u4 = m_Lanes2[3];
+	for (; size >= sizeof(m_Buffer); p += sizeof(m_Buffer), size -= sizeof(m_Buffer))
+	{
+		uint64_t w1 = read64(p), w2 = read64(p + 8), w3 = read64(p + 16), w4 = read64(p + 24);
+		v1 = round(v1, w1);
+		v2 = round(v2, w2);
+		v3 = round(v3, w3);
+		v4 = round(v4, w4);
+		u1 = round2(u1, w1, w2);
+		u2 = round2(u2, w2, w3);
+		u3 = round2(u3, w3, w4);
+		u4 = round2(u4, w4, w1);
+	}
+	m_Lanes[0] = v1;
+	m_Lanes[1] = v2;
+	m_Lanes[2] = v3;
+	m_Lanes[3] = v4;
+	m_Lanes2[0] = u1;
+	m_Lanes2[1] = u2;
+	m_Lanes2[2] = u3;
+	m_Lanes2[3] = u4;
+
+	memcpy(m_Buffer, p, size);
+	m_BufferSize = size;
+}
+
+std::string ContentHashContext::finish()
+{
+	const uint64_t * v = m_Lanes;
+	const uint64_t * u = m_Lanes2;
+
+	// Halves of the result are derived from different sets of lanes
+	uint64_t h1, h2;
+	if (m_TotalSize >= sizeof(m_Buffer))
+	{
+		h1 = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+		h1 = mergeRound(mergeRound(mergeRound(mergeRound(h1, v[0]), v[1]), v[2]), v[3]);
+		h2 = rotl(u[0], 3) + rotl(u[1], 11) + rotl(u[2], 21) + rotl(u[3], 37);
+		h2 = mergeRound2(mergeRound2(mergeRound2(mergeRound2(h2, u[0]), u[1]), u[2]), u[3]);
+	}
+	else
+	{
+		h1 = PRIME5;
+		h2 = PRIME3;
+	}
+
+	h1 += m_TotalSize;
+	h2 += m_TotalSize * PRIME1;
+
+	const unsigned char * p = m_Buffer;
+	size_t size = m_BufferSize;
+	for (; size >= 8; p += 8, size -= 8)
+	{
+		uint64_t k = round(0, read64(p));
+		h1 = rotl(h1 ^ k, 27) * PRIME1 + PRIME4;
+		h2 = rotl(h2 ^ k, 31) * PRIME2 + PRIME5;
+	}
+	if (size >= 4)
+	{
+		uint64_t k = read32(p);
+		h1 = rotl(h1 ^ (k * PRIME1), 23) * PRIME2 + PRIME3;
+		h2 = rotl(h2 ^ (k * PRIME2), 19) * PRIME1 + PRIME4;
+		p += 4;
+		size -= 4;
+	}
+	for (; size > 0; ++p, --size)
+	{
+		h1 = rotl(h1 ^ (*p * PRIME5), 11) * PRIME1;
+		h2 = rotl(h2 ^ (*p * PRIME1), 13) * PRIME2;
+	}
+
+	// Each half of the result depends on both halves of the state
+	h1 += h2;
+	h2 += h1;
+
+	std::string result;
+	result.reserve(32);
+	appendHex(result, avalanche(h1));
+	appendHex(result, avalanche(h2));
+	return result;
+}
+
+std::string contentHash(const std::string & data)
+{
+	ContentHashContext ctx;
+	ctx.update(data.data(), data.length());
+	return ctx.finish();
+}
@@ -0,0 +1,59 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __6211ef7233484de8a39fd87808d8059b__
+#define __6211ef7233484de8a39fd87808d8059b__
+
+#include "hasher.h"
+#include <cstdint>
+#include <string>
+
+// Fast non-cryptographic 128-bit hash for change detection. Input is processed in 32-byte stripes by two sets
+// of four lanes. The first set uses XXH64 rounds, the second one uses different constants and mixes adjacent
+// words of the stripe, like XXH3 does. Halves of the result are derived from different sets, so that it is not
+// a 64-bit hash stored in 128 bits. All eight lanes are independent, so that the multiplications could be
+// executed in parallel. Not suitable for names that should stay stable between versions of yip: use SHA1 for
+// these.
+class ContentHashContext : public Hasher
+{
+public:
+	ContentHashContext();
+
+	void update(const void * data, size_t size) override;
+	std::string finish() override;
+
+private:
+	uint64_t m_Lanes[4];
+	uint64_t m_Lanes2[4];
+	unsigned char m_Buffer[32];
+	size_t m_BufferSize;
+	uint64_t m_TotalSize;
+
+	void processStripe(const unsigned char * p);
+
+	ContentHashContext(const ContentHashContext &) = delete;
+	ContentHashContext & operator=(const ContentHashContext &) = delete;
+};
+
+std::string contentHash(const std::string & data);
+
+#endif
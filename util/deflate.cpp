@@ -0,0 +1,95 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "deflate.h"
+#include "cxx-util/cxx-util/fmt.h"
+#include <stdexcept>
+#include <cstring>
+
+#define OUTPUT_BUFFER_SIZE 65536
+
+DeflateStream::DeflateStream(const WriteFunc & write, int level, bool raw)
+	: m_Write(write),
+	  m_Finished(false)
+{
+	memset(&m_Stream, 0, sizeof(m_Stream));
+
+	int windowBits = (raw ? -MAX_WBITS : MAX_WBITS);
+	int r = deflateInit2(&m_Stream, level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY);
+	if (r != Z_OK)
+		throw std::runtime_error(fmt() << "unable to initialize zlib compressor (code " << r << ").");
+}
+
+DeflateStream::~DeflateStream()
+{
+	deflateEnd(&m_Stream);
+}
+
+void DeflateStream::write(const void * data, size_t size)
+{
+	if (m_Finished)
+		throw std::runtime_error("attempted to write into a finished deflate stream.");
+
+	const unsigned char * p = reinterpret_cast<const unsigned char *>(data);
+	while (size > 0)
+	{
+		uInt length = (size > 0x40000000 ? 0x40000000 : static_cast<uInt>(size));
+		m_Stream.next_in = const_cast<Bytef *>(p);
+		m_Stream.avail_in = length;
+		process(Z_NO_FLUSH);
+		p += length;
+		size -= length;
+	}
+}
+
+void DeflateStream::finish()
+{
+	if (m_Finished)
+		return;
+
+	m_Stream.next_in = nullptr;
+	m_Stream.avail_in = 0;
+	process(Z_FINISH);
+
+	m_Finished = true;
+}
+
+void DeflateStream::process(int flush)
+{
+	unsigned char buf[OUTPUT_BUFFER_SIZE];
+	for (;;)
+	{
+		m_Stream.next_out = buf;
+		m_Stream.avail_out = sizeof(buf);
+
+		int r = deflate(&m_Stream, flush);
+		if (r != Z_OK && r != Z_STREAM_END && r != Z_BUF_ERROR)
+			throw std::runtime_error(fmt() << "zlib compression failed (code " << r << ").");
+
+		size_t length = sizeof(buf) - m_Stream.avail_out;
+		if (length > 0)
+			m_Write(buf, length);
+
+		if (flush == Z_FINISH ? r == Z_STREAM_END : m_Stream.avail_in == 0 && m_Stream.avail_out != 0)
+			break;
+	}
+}
@@ -0,0 +1,53 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __cf6a609a8d234f51afb66f45850b4f7e__
+#define __cf6a609a8d234f51afb66f45850b4f7e__
+
+#include "../3rdparty/zlib/zlib.h"
+#include <functional>
+#include <string>
+
+class DeflateStream
+{
+public:
+	typedef std::function<void(const void * data, size_t size)> WriteFunc;
+
+	// If 'raw' is true, no zlib header and checksum are written into the output stream
+	DeflateStream(const WriteFunc & write, int level = Z_BEST_COMPRESSION, bool raw = false);
+	~DeflateStream();
+
+	void write(const void * data, size_t size);
+	void finish();
+
+private:
+	z_stream m_Stream;
+	WriteFunc m_Write;
+	bool m_Finished;
+
+	void process(int flush);
+
+	DeflateStream(const DeflateStream &) = delete;
+	DeflateStream & operator=(const DeflateStream &) = delete;
+};
+
+#endif
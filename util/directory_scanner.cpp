@@ -0,0 +1,272 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "directory_scanner.h"
+#include "file_stat.h"
+#include "cxx-util/cxx-util/fmt.h"
+#include <algorithm>
+#include <stdexcept>
+#include <mutex>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstddef>
+#endif
+
+// Modification times this close to the time of reading could change again without being noticed
+#define DIRECTORY_RACY_TIME_NS 2000000000LL
+
+#ifdef __linux__
+namespace
+{
+	struct LinuxDirent64
+	{
+		uint64_t d_ino;
+		int64_t d_off;
+		unsigned short d_reclen;
+		unsigned char d_type;
+		char d_name[1];
+	};
+
+	struct FileDescriptor
+	{
+		int fd;
+
+		inline explicit FileDescriptor(int f) : fd(f) {}
+		inline ~FileDescriptor() { if (fd >= 0) close(fd); }
+
+		FileDescriptor(const FileDescriptor &) = delete;
+		FileDescriptor & operator=(const FileDescriptor &) = delete;
+	};
+}
+#endif
+
+struct DirectoryScanner::Scan
+{
+	std::string path;
+	size_t maxDepth;
+	Filter filter;
+	long long racyTime;
+	std::mutex mutex;
+	std::vector<std::pair<std::string, std::vector<std::string>>> directories;	// Files in each directory
+  #ifdef __linux__
+	int fd;
+  #endif
+};
+
+// Chain of directories from the root of the scan. Directories reached through symbolic links are listed under
+// every path leading to them, unless the link points to an ancestor of itself and would form a cycle.
+struct DirectoryScanner::Ancestor
+{
+	unsigned long long device;
+	unsigned long long inode;
+	AncestorPtr parent;
+};
+
+DirectoryScanner::DirectoryScanner(Cache * cache, size_t numThreads)
+	: m_Cache(cache),
+	  m_ThreadPool(numThreads)
+{
+}
+
+DirectoryScanner::~DirectoryScanner()
+{
+}
+
+DirectoryScanner::Result DirectoryScanner::scan(const std::string & path, size_t maxDepth, const Filter & filter)
+{
+	Scan scan;
+	scan.path = path;
+	scan.maxDepth = maxDepth;
+	scan.filter = filter;
+	scan.racyTime = static_cast<long long>(time(nullptr)) * 1000000000LL - DIRECTORY_RACY_TIME_NS;
+
+  #ifdef __linux__
+	FileDescriptor root(open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+	if (root.fd < 0)
+	{
+		int err = errno;
+		throw std::runtime_error(fmt() << "unable to open directory '" << path << "': " << strerror(err));
+	}
+	scan.fd = root.fd;
+  #endif
+
+	m_ThreadPool.run([this, &scan]() { scanDirectory(scan, std::string(), 0, AncestorPtr()); });
+	m_ThreadPool.wait();
+
+	// Listings are sorted per directory, which is much cheaper than sorting the whole tree
+	std::sort(scan.directories.begin(), scan.directories.end(),
+		[](const std::pair<std::string, std::vector<std::string>> & a,
+				const std::pair<std::string, std::vector<std::string>> & b) {
+			return a.first < b.first;
+		});
+
+	Result result;
+	size_t numFiles = 0;
+	for (const auto & it : scan.directories)
+		numFiles += it.second.size();
+	result.files.reserve(numFiles);
+	result.directories.reserve(scan.directories.size());
+	for (auto & it : scan.directories)
+	{
+		result.directories.push_back(std::move(it.first));
+		for (std::string & file : it.second)
+			result.files.push_back(std::move(file));
+	}
+
+	return result;
+}
+
+void DirectoryScanner::scanDirectory(Scan & scan, const std::string & relativePath, size_t depth,
+	const AncestorPtr & parent)
+{
+	DirEntryList list;
+	AncestorPtr self;
+	if (!readDirectory(scan, relativePath, parent, self, list))
+		return;
+
+	std::sort(list.begin(), list.end(), [](const DirEntry & a, const DirEntry & b) { return a.name < b.name; });
+
+	std::vector<std::string> files;
+	files.reserve(list.size());
+
+	for (const DirEntry & entry : list)
+	{
+		std::string path = (relativePath.empty() ? entry.name : relativePath + '/' + entry.name);
+		if (entry.type != DirEntry_Directory)
+			files.push_back(std::move(path));
+		else if (depth < scan.maxDepth && (!scan.filter || scan.filter(path)))
+			m_ThreadPool.run([this, &scan, path, depth, self]() { scanDirectory(scan, path, depth + 1, self); });
+	}
+
+	std::lock_guard<std::mutex> lock(scan.mutex);
+	scan.directories.push_back(std::make_pair(relativePath, std::move(files)));
+}
+
+bool DirectoryScanner::readDirectory(Scan & scan, const std::string & relativePath, const AncestorPtr & parent,
+	AncestorPtr & self, DirEntryList & list)
+{
+	std::string fullPath = (relativePath.empty() ? scan.path : pathConcat(scan.path, relativePath));
+
+  #ifdef __linux__
+	FileDescriptor dir(openat(scan.fd, (relativePath.empty() ? "." : relativePath.c_str()),
+		O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+	if (dir.fd < 0)
+	{
+		int err = errno;
+		throw std::runtime_error(fmt() << "unable to open directory '" << fullPath << "': " << strerror(err));
+	}
+
+	struct stat st;
+	if (fstat(dir.fd, &st) != 0)
+	{
+		int err = errno;
+		throw std::runtime_error(fmt() << "unable to stat directory '" << fullPath << "': " << strerror(err));
+	}
+
+	for (const Ancestor * ancestor = parent.get(); ancestor; ancestor = ancestor->parent.get())
+	{
+		if (ancestor->device == static_cast<unsigned long long>(st.st_dev)
+				&& ancestor->inode == static_cast<unsigned long long>(st.st_ino))
+			return false;
+	}
+	self = std::make_shared<Ancestor>(Ancestor{ static_cast<unsigned long long>(st.st_dev),
+		static_cast<unsigned long long>(st.st_ino), parent });
+
+	long long modificationTimeNs = static_cast<long long>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+	if (m_Cache && m_Cache->lookupDirectory(fullPath, modificationTimeNs, list))
+		return true;
+
+	alignas(LinuxDirent64) char buffer[32768];
+	for (;;)
+	{
+		long size = syscall(SYS_getdents64, dir.fd, buffer, sizeof(buffer));
+		if (size < 0)
+		{
+			int err = errno;
+			throw std::runtime_error(fmt() << "unable to read directory '" << fullPath << "': " << strerror(err));
+		}
+		if (size == 0)
+			break;
+
+		for (long offset = 0; offset < size; )
+		{
+			const LinuxDirent64 * dirent = reinterpret_cast<const LinuxDirent64 *>(buffer + offset);
+			const char * name = buffer + offset + offsetof(LinuxDirent64, d_name);
+			offset += dirent->d_reclen;
+
+			if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0)))
+				continue;
+
+			// Symbolic links are followed; some file systems do not report type of the entry
+			unsigned char type = dirent->d_type;
+			if (type == DT_LNK || type == DT_UNKNOWN)
+			{
+				struct stat entrySt;
+				if (fstatat(dir.fd, name, &entrySt, 0) == 0 && S_ISDIR(entrySt.st_mode))
+					type = DT_DIR;
+			}
+
+			DirEntry entry;
+			entry.name = name;
+			entry.type = (type == DT_DIR ? DirEntry_Directory : DirEntry_File);
+			list.push_back(std::move(entry));
+		}
+	}
+
+	if (m_Cache && modificationTimeNs < scan.racyTime)
+		m_Cache->storeDirectory(fullPath, modificationTimeNs, list);
+  #else
+	FileStat st;
+	if (!fileStat(fullPath, st))
+		throw std::runtime_error(fmt() << "unable to stat directory '" << fullPath << "'.");
+
+	// Device is not known here, inode is zero on platforms without inodes
+	if (st.inode != 0)
+	{
+		for (const Ancestor * ancestor = parent.get(); ancestor; ancestor = ancestor->parent.get())
+		{
+			if (ancestor->inode == st.inode)
+				return false;
+		}
+		self = std::make_shared<Ancestor>(Ancestor{ 0, st.inode, parent });
+	}
+
+	if (m_Cache && m_Cache->lookupDirectory(fullPath, st.modificationTimeNs, list))
+		return true;
+
+	list = pathEnumDirectoryContents(fullPath);
+
+	if (m_Cache && st.modificationTimeNs < scan.racyTime)
+		m_Cache->storeDirectory(fullPath, st.modificationTimeNs, list);
+  #endif
+
+	return true;
+}
@@ -0,0 +1,86 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __5eb4dcc6f26445a5ac52c2fb6e145e39__
+#define __5eb4dcc6f26445a5ac52c2fb6e145e39__
+
+#include "thread_pool.h"
+#include "path-util/path-util.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Recursively lists contents of a directory. Subdirectories are read in parallel. On Linux directories are
+// opened relative to the descriptor of the scanned directory and read with getdents64.
+class DirectoryScanner
+{
+public:
+	// Stores listings of directories between runs. Listing is valid while modification time of the directory
+	// stays the same.
+	class Cache
+	{
+	public:
+		virtual ~Cache() {}
+
+		virtual bool lookupDirectory(const std::string & path, long long modificationTimeNs,
+			DirEntryList & list) = 0;
+		virtual void storeDirectory(const std::string & path, long long modificationTimeNs,
+			const DirEntryList & list) = 0;
+	};
+
+	struct Result
+	{
+		std::vector<std::string> files;			// Paths relative to the scanned directory, grouped by directory
+		std::vector<std::string> directories;	// Sorted relative paths of scanned directories (root is empty)
+	};
+
+	// Receives relative path of a subdirectory and returns false if it should not be entered
+	typedef std::function<bool(const std::string & relativePath)> Filter;
+
+	// If 'numThreads' is zero, number of hardware threads is used
+	explicit DirectoryScanner(Cache * cache = nullptr, size_t numThreads = 0);
+	~DirectoryScanner();
+
+	// Relative paths use '/' as a separator. Subdirectories deeper than 'maxDepth' or rejected by 'filter'
+	// are not entered.
+	Result scan(const std::string & path, size_t maxDepth = SIZE_MAX, const Filter & filter = Filter());
+
+private:
+	struct Scan;
+	struct Ancestor;
+
+	typedef std::shared_ptr<const Ancestor> AncestorPtr;
+
+	Cache * m_Cache;
+	ThreadPool m_ThreadPool;
+
+	void scanDirectory(Scan & scan, const std::string & relativePath, size_t depth, const AncestorPtr & parent);
+	bool readDirectory(Scan & scan, const std::string & relativePath, const AncestorPtr & parent,
+		AncestorPtr & self, DirEntryList & list);
+
+	DirectoryScanner(const DirectoryScanner &) = delete;
+	DirectoryScanner & operator=(const DirectoryScanner &) = delete;
+};
+
+#endif
@@ -0,0 +1,190 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "file_cache.h"
+#include "file_stat.h"
+#include "path-util/path-util.h"
+#include "cxx-util/cxx-util/fmt.h"
+#include <stdexcept>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+
+#ifdef _WIN32
+#include <sys/utime.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <utime.h>
+#include <unistd.h>
+#endif
+
+// Copies contents of the file, optionally passing them to the hasher. Returns number of bytes copied.
+static size_t copyFile(FILE * in, const std::string & inFile, const std::string & outFile, Hasher * hasher)
+{
+	FILE * out = fopen(outFile.c_str(), "wb");
+	if (!out)
+		throw std::runtime_error(fmt() << "unable to create file '" << outFile << "': " << strerror(errno));
+
+	size_t size = 0;
+	try
+	{
+		char buf[65536];
+		for (;;)
+		{
+			size_t bytesRead = fread(buf, 1, sizeof(buf), in);
+			if (ferror(in))
+				throw std::runtime_error(fmt() << "unable to read file '" << inFile << "'.");
+			if (bytesRead == 0)
+				break;
+			if (fwrite(buf, 1, bytesRead, out) != bytesRead)
+				throw std::runtime_error(fmt() << "unable to write file '" << outFile << "': " << strerror(errno));
+			if (hasher)
+				hasher->update(buf, bytesRead);
+			size += bytesRead;
+		}
+
+		if (fclose(out) != 0)
+		{
+			out = nullptr;
+			throw std::runtime_error(fmt() << "unable to write file '" << outFile << "': " << strerror(errno));
+		}
+	}
+	catch (...)
+	{
+		if (out)
+			fclose(out);
+		remove(outFile.c_str());
+		throw;
+	}
+
+	return size;
+}
+
+/* FileCache */
+
+FileCache::FileCache(const std::string & path)
+	: m_Path(path)
+{
+}
+
+bool FileCache::fetch(const std::string & key, const std::string & file, Hasher & hasher, size_t & size)
+{
+	std::string entry = entryPath(key);
+	FILE * f = fopen(entry.c_str(), "rb");
+	if (!f)
+		return false;
+
+	try
+	{
+		size = copyFile(f, entry, file, &hasher);
+	}
+	catch (...)
+	{
+		fclose(f);
+		throw;
+	}
+	fclose(f);
+
+	// Recently used entries are kept by the garbage collector
+	utime(entry.c_str(), nullptr);
+
+	return true;
+}
+
+void FileCache::store(const std::string & key, const std::string & file)
+{
+	std::string entry = entryPath(key);
+	if (pathIsExistent(entry))
+		return;
+
+	FILE * f = fopen(file.c_str(), "rb");
+	if (!f)
+		throw std::runtime_error(fmt() << "unable to open file '" << file << "'.");
+
+	// Entry is copied into the temporary file first, so that other processes never see a partial entry.
+	// Files are copied rather than hardlinked, so that in-place modification of the output file by some
+	// other tool could not corrupt the cache.
+	pathCreate(pathGetDirectory(entry));
+	std::string tempFile = fmt() << entry << ".tmp" << getpid();
+	try
+	{
+		copyFile(f, file, tempFile, nullptr);
+	}
+	catch (...)
+	{
+		fclose(f);
+		throw;
+	}
+	fclose(f);
+
+	// Another process could have stored the same entry in the meantime. It has the same contents.
+	if (rename(tempFile.c_str(), entry.c_str()) != 0)
+		remove(tempFile.c_str());
+}
+
+FileCache::GarbageStats FileCache::collectGarbage(unsigned maxAgeDays)
+{
+	GarbageStats stats;
+	stats.numFiles = 0;
+	stats.bytesFreed = 0;
+
+	if (!pathIsExistent(m_Path))
+		return stats;
+
+	long long cutoff = (static_cast<long long>(time(nullptr)) - static_cast<long long>(maxAgeDays) * 86400)
+		* 1000000000LL;
+
+	for (const DirEntry & dir : pathEnumDirectoryContents(m_Path))
+	{
+		if (dir.type != DirEntry_Directory)
+			continue;
+
+		std::string dirPath = pathConcat(m_Path, dir.name);
+		for (const DirEntry & file : pathEnumDirectoryContents(dirPath))
+		{
+			FileStat st;
+			std::string filePath = pathConcat(dirPath, file.name);
+			if (file.type == DirEntry_Directory || !fileStat(filePath, st) || st.modificationTimeNs >= cutoff)
+				continue;
+
+			if (remove(filePath.c_str()) != 0)
+			{
+				std::cerr << "warning: unable to delete file '" << filePath << "': " << strerror(errno) << std::endl;
+				continue;
+			}
+
+			++stats.numFiles;
+			stats.bytesFreed += st.size;
+		}
+	}
+
+	return stats;
+}
+
+// Entries are spread between 256 subdirectories, so that directories do not grow too large
+std::string FileCache::entryPath(const std::string & key) const
+{
+	return pathConcat(pathConcat(m_Path, key.substr(0, 2)), key.substr(2));
+}
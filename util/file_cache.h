@@ -0,0 +1,60 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __fd04242fb91a4102bea93db0db2a2d47__
+#define __fd04242fb91a4102bea93db0db2a2d47__
+
+#include "hasher.h"
+#include <string>
+
+// Directory of files addressed by keys. Entries are never modified after they have been stored, so the cache
+// could be shared by multiple processes. Modification time of an entry is updated when it is used.
+class FileCache
+{
+public:
+	struct GarbageStats
+	{
+		size_t numFiles;
+		unsigned long long bytesFreed;
+	};
+
+	FileCache(const std::string & path);
+
+	inline const std::string & path() const { return m_Path; }
+
+	// Copies the cached file into the specified file, passing its contents to the hasher.
+	// Returns false if there is no file with the specified key in the cache.
+	bool fetch(const std::string & key, const std::string & file, Hasher & hasher, size_t & size);
+	void store(const std::string & key, const std::string & file);
+
+	GarbageStats collectGarbage(unsigned maxAgeDays);
+
+private:
+	std::string m_Path;
+
+	std::string entryPath(const std::string & key) const;
+
+	FileCache(const FileCache &) = delete;
+	FileCache & operator=(const FileCache &) = delete;
+};
+
+#endif
@@ -0,0 +1,115 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "file_lock.h"
+#include "cxx-util/cxx-util/fmt.h"
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+FileLock::FileLock(const std::string & path)
+	: m_Path(path)
+  #ifdef _WIN32
+	, m_RemoveFile(false)
+  #endif
+{
+  #ifdef _WIN32
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+		nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+		throw std::runtime_error(fmt() << "unable to open lock file '" << path << "'.");
+
+	OVERLAPPED overlapped;
+	memset(&overlapped, 0, sizeof(overlapped));
+	if (!LockFileEx(handle, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped))
+	{
+		CloseHandle(handle);
+		throw std::runtime_error(fmt() << "unable to lock file '" << path << "'.");
+	}
+
+	m_Handle = handle;
+  #else
+	for (;;)
+	{
+		m_Fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+		if (m_Fd < 0)
+			throw std::runtime_error(fmt() << "unable to open lock file '" << path << "': " << strerror(errno));
+
+		// flock() locks belong to the open file description, so they also work between threads
+		while (flock(m_Fd, LOCK_EX) != 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			int err = errno;
+			close(m_Fd);
+			throw std::runtime_error(fmt() << "unable to lock file '" << path << "': " << strerror(err));
+		}
+
+		// Lock file could have been deleted by the previous owner of the lock while this process was waiting
+		struct stat st1, st2;
+		if (fstat(m_Fd, &st1) == 0 && stat(path.c_str(), &st2) == 0 && st1.st_dev == st2.st_dev
+				&& st1.st_ino == st2.st_ino)
+			break;
+
+		flock(m_Fd, LOCK_UN);
+		close(m_Fd);
+	}
+  #endif
+}
+
+FileLock::~FileLock()
+{
+  #ifdef _WIN32
+	OVERLAPPED overlapped;
+	memset(&overlapped, 0, sizeof(overlapped));
+	UnlockFileEx(static_cast<HANDLE>(m_Handle), 0, 1, 0, &overlapped);
+	CloseHandle(static_cast<HANDLE>(m_Handle));
+
+	// Files opened without FILE_SHARE_DELETE could not be deleted, so this fails if another process has
+	// opened the lock file in the meantime
+	if (m_RemoveFile)
+		DeleteFileA(m_Path.c_str());
+  #else
+	flock(m_Fd, LOCK_UN);
+	close(m_Fd);
+  #endif
+}
+
+void FileLock::removeFile()
+{
+  #ifdef _WIN32
+	m_RemoveFile = true;
+  #else
+	// The file is deleted while the lock is held, waiting processes notice that and open the new file
+	unlink(m_Path.c_str());
+  #endif
+}
@@ -0,0 +1,54 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __02d1afc625704f5b96925c6ce9e89f77__
+#define __02d1afc625704f5b96925c6ce9e89f77__
+
+#include <string>
+
+// Advisory lock held on a file for the lifetime of the object. The lock file is created if it does not exist.
+// Locks exclude each other both between processes and between threads of the same process.
+class FileLock
+{
+public:
+	FileLock(const std::string & path);
+	~FileLock();
+
+	inline const std::string & path() const { return m_Path; }
+
+	// Deletes the lock file when the lock is released. Processes waiting for the lock then lock a new file.
+	void removeFile();
+
+private:
+	std::string m_Path;
+  #ifdef _WIN32
+	void * m_Handle;
+	bool m_RemoveFile;
+  #else
+	int m_Fd;
+  #endif
+
+	FileLock(const FileLock &) = delete;
+	FileLock & operator=(const FileLock &) = delete;
+};
+
+#endif
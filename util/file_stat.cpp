@@ -0,0 +1,49 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "file_stat.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+
+bool fileStat(const std::string & path, FileStat & st)
+{
+  #ifdef _WIN32
+	struct __stat64 s;
+	if (_stat64(path.c_str(), &s) != 0)
+		return false;
+	st.size = static_cast<unsigned long long>(s.st_size);
+	st.modificationTimeNs = static_cast<long long>(s.st_mtime) * 1000000000LL;
+	st.inode = 0;
+  #else
+	struct stat s;
+	if (stat(path.c_str(), &s) != 0)
+		return false;
+	st.size = static_cast<unsigned long long>(s.st_size);
+   #if defined(__APPLE__)
+	st.modificationTimeNs = static_cast<long long>(s.st_mtimespec.tv_sec) * 1000000000LL + s.st_mtimespec.tv_nsec;
+   #else
+	st.modificationTimeNs = static_cast<long long>(s.st_mtim.tv_sec) * 1000000000LL + s.st_mtim.tv_nsec;
+   #endif
+	st.inode = static_cast<unsigned long long>(s.st_ino);
+  #endif
+	return true;
+}
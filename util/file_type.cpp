@@ -68,6 +68,7 @@ static void init()
 		g_ExtMap.insert(std::make_pair(".hpp", FILE_SOURCE_CXX_HEADER));
 		g_ExtMap.insert(std::make_pair(".m", FILE_SOURCE_OBJC));
 		g_ExtMap.insert(std::make_pair(".mm", FILE_SOURCE_OBJCXX));
+		g_ExtMap.insert(std::make_pair(".S", FILE_SOURCE_ASM));
 		g_ExtMap.insert(std::make_pair(".java", FILE_SOURCE_JAVA));
 		g_ExtMap.insert(std::make_pair(".js", FILE_SOURCE_JAVASCRIPT));
 		g_ExtMap.insert(std::make_pair(".lua", FILE_SOURCE_LUA));
@@ -181,6 +182,7 @@ FileType fileTypeFromString(const std::string & name)
 		g_ConstMap.insert(std::make_pair("source/cxx-header", FILE_SOURCE_CXX_HEADER));
 		g_ConstMap.insert(std::make_pair("source/objective-c", FILE_SOURCE_OBJC));
 		g_ConstMap.insert(std::make_pair("source/objective-cxx", FILE_SOURCE_OBJCXX));
+		g_ConstMap.insert(std::make_pair("source/asm", FILE_SOURCE_ASM));
 		g_ConstMap.insert(std::make_pair("source/java", FILE_SOURCE_JAVA));
 		g_ConstMap.insert(std::make_pair("source/javascript", FILE_SOURCE_JAVASCRIPT));
 		g_ConstMap.insert(std::make_pair("source/lua", FILE_SOURCE_LUA));
@@ -59,6 +59,7 @@ enum FileType
 	FILE_SOURCE_CXX_HEADER,
 	FILE_SOURCE_OBJC,
 	FILE_SOURCE_OBJCXX,
+	FILE_SOURCE_ASM,
 	FILE_SOURCE_JAVA,
 	FILE_SOURCE_JAVASCRIPT,
 	FILE_SOURCE_LUA,
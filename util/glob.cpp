@@ -0,0 +1,156 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "glob.h"
+#include <cstdint>
+
+bool globIsPattern(const std::string & str)
+{
+	return str.find_first_of("*?") != std::string::npos;
+}
+
+static bool matchComponent(const char * p, const char * pEnd, const char * s, const char * sEnd)
+{
+	while (p < pEnd)
+	{
+		if (*p == '*')
+		{
+			while (p < pEnd && *p == '*')
+				++p;
+			if (p == pEnd)
+				return true;
+			for (; s < sEnd; ++s)
+			{
+				if (matchComponent(p, pEnd, s, sEnd))
+					return true;
+			}
+			return false;
+		}
+
+		if (s == sEnd || (*p != '?' && *p != *s))
+			return false;
+
+		++p;
+		++s;
+	}
+
+	return s == sEnd;
+}
+
+static const char * componentEnd(const char * p, const char * end)
+{
+	while (p < end && *p != '/')
+		++p;
+	return p;
+}
+
+static bool matchPath(const char * p, const char * pEnd, const char * s, const char * sEnd)
+{
+	for (;;)
+	{
+		const char * pc = componentEnd(p, pEnd);
+
+		if (pc - p == 2 && p[0] == '*' && p[1] == '*')
+		{
+			const char * next = (pc < pEnd ? pc + 1 : pc);
+			for (;;)
+			{
+				if (matchPath(next, pEnd, s, sEnd))
+					return true;
+				if (s == sEnd || *s == '.')
+					return false;
+				s = componentEnd(s, sEnd);
+				if (s < sEnd)
+					++s;
+			}
+		}
+
+		const char * sc = componentEnd(s, sEnd);
+		if (s < sc && *s == '.' && (p == pc || *p != '.'))
+			return false;
+		if (!matchComponent(p, pc, s, sc))
+			return false;
+
+		if (pc == pEnd || sc == sEnd)
+			return pc == pEnd && sc == sEnd;
+
+		p = pc + 1;
+		s = sc + 1;
+	}
+}
+
+bool globMatch(const std::string & pattern, const std::string & path)
+{
+	const char * p = pattern.c_str();
+	const char * s = path.c_str();
+	return matchPath(p, p + pattern.length(), s, s + path.length());
+}
+
+bool globNamesHidden(const std::string & pattern)
+{
+	for (size_t pos = 0; pos < pattern.length(); )
+	{
+		if (pattern[pos] == '.')
+			return true;
+		pos = pattern.find('/', pos);
+		if (pos == std::string::npos)
+			break;
+		++pos;
+	}
+	return false;
+}
+
+size_t globSplit(const std::string & pattern, std::string & baseDir, std::string & rest)
+{
+	size_t wildcard = pattern.find_first_of("*?");
+	size_t slash = (wildcard == std::string::npos ? pattern.rfind('/') : pattern.rfind('/', wildcard));
+
+	if (slash == std::string::npos)
+	{
+		baseDir.clear();
+		rest = pattern;
+	}
+	else
+	{
+		baseDir = pattern.substr(0, (slash == 0 ? 1 : slash));
+		rest = pattern.substr(slash + 1);
+	}
+
+	size_t depth = 0;
+	for (size_t pos = 0; pos < rest.length(); )
+	{
+		size_t end = rest.find('/', pos);
+		if (end == std::string::npos)
+			break;
+		if (end - pos == 2 && rest[pos] == '*' && rest[pos + 1] == '*')
+			return SIZE_MAX;
+		++depth;
+		pos = end + 1;
+	}
+
+	// Trailing '**' matches files at any depth
+	if (rest.length() >= 2 && rest.compare(rest.length() - 2, 2, "**") == 0
+			&& (rest.length() == 2 || rest[rest.length() - 3] == '/'))
+		return SIZE_MAX;
+
+	return depth;
+}
@@ -0,0 +1,42 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __fb22f7d79d0b4e69a3dbd2266db608e9__
+#define __fb22f7d79d0b4e69a3dbd2266db608e9__
+
+#include <string>
+
+// Glob patterns use '/' as a directory separator. '*' matches any sequence of characters except '/', '?' matches
+// any single character except '/' and a '**' component matches any number of directories (including zero).
+// Names starting with '.' are matched only by pattern components that start with '.' as well.
+
+bool globIsPattern(const std::string & str);
+bool globMatch(const std::string & pattern, const std::string & path);
+
+// Returns true if some component of the pattern starts with '.' and could match a hidden file or directory
+bool globNamesHidden(const std::string & pattern);
+
+// Splits pattern into the longest leading directory without wildcards and the remaining part. Returns maximum
+// depth of subdirectories of the base directory that could contain matching files (SIZE_MAX if unbounded).
+size_t globSplit(const std::string & pattern, std::string & baseDir, std::string & rest);
+
+#endif
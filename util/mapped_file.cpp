@@ -0,0 +1,117 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "mapped_file.h"
+#include "cxx-util/cxx-util/fmt.h"
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string & path)
+	: m_Path(path),
+	  m_Data(""),
+	  m_Size(0)
+{
+  #ifdef _WIN32
+	m_Mapping = nullptr;
+	m_Handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_Handle == INVALID_HANDLE_VALUE)
+		throw std::runtime_error(fmt() << "unable to open file '" << path << "'.");
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(static_cast<HANDLE>(m_Handle), &size))
+	{
+		CloseHandle(static_cast<HANDLE>(m_Handle));
+		throw std::runtime_error(fmt() << "unable to determine size of file '" << path << "'.");
+	}
+
+	// Empty files could not be mapped
+	if (size.QuadPart == 0)
+		return;
+
+	m_Mapping = CreateFileMappingA(static_cast<HANDLE>(m_Handle), nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void * data = (m_Mapping ? MapViewOfFile(static_cast<HANDLE>(m_Mapping), FILE_MAP_READ, 0, 0, 0) : nullptr);
+	if (!data)
+	{
+		if (m_Mapping)
+			CloseHandle(static_cast<HANDLE>(m_Mapping));
+		CloseHandle(static_cast<HANDLE>(m_Handle));
+		throw std::runtime_error(fmt() << "unable to map file '" << path << "' into memory.");
+	}
+
+	m_Data = static_cast<const char *>(data);
+	m_Size = static_cast<size_t>(size.QuadPart);
+  #else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error(fmt() << "unable to open file '" << path << "': " << strerror(errno));
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		int err = errno;
+		close(fd);
+		throw std::runtime_error(fmt() << "unable to stat file '" << path << "': " << strerror(err));
+	}
+
+	// Empty files could not be mapped
+	if (st.st_size == 0)
+	{
+		close(fd);
+		return;
+	}
+
+	void * data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	int err = errno;
+	close(fd);
+	if (data == MAP_FAILED)
+		throw std::runtime_error(fmt() << "unable to map file '" << path << "' into memory: " << strerror(err));
+
+	m_Data = static_cast<const char *>(data);
+	m_Size = static_cast<size_t>(st.st_size);
+  #endif
+}
+
+MappedFile::~MappedFile()
+{
+  #ifdef _WIN32
+	if (m_Mapping)
+	{
+		UnmapViewOfFile(m_Data);
+		CloseHandle(static_cast<HANDLE>(m_Mapping));
+	}
+	CloseHandle(static_cast<HANDLE>(m_Handle));
+  #else
+	if (m_Size > 0)
+		munmap(const_cast<char *>(m_Data), m_Size);
+  #endif
+}
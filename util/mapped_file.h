@@ -0,0 +1,54 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __ea0cbef576fc44afa11d627200a6da2a__
+#define __ea0cbef576fc44afa11d627200a6da2a__
+
+#include <string>
+#include <cstddef>
+
+// Read-only memory mapping of a file for the lifetime of the object
+class MappedFile
+{
+public:
+	MappedFile(const std::string & path);
+	~MappedFile();
+
+	inline const std::string & path() const { return m_Path; }
+
+	inline const char * data() const { return m_Data; }
+	inline size_t size() const { return m_Size; }
+
+private:
+	std::string m_Path;
+	const char * m_Data;
+	size_t m_Size;
+  #ifdef _WIN32
+	void * m_Handle;
+	void * m_Mapping;
+  #endif
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile & operator=(const MappedFile &) = delete;
+};
+
+#endif
@@ -21,17 +21,23 @@
 // THE SOFTWARE.
 //
 #include "sha1.h"
-#include "../3rdparty/openssl/include/openssl/sha.h"
 
-std::string sha1(const std::string & data)
+SHA1Context::SHA1Context()
+{
+	SHA1_Init(&m_Context);
+}
+
+void SHA1Context::update(const void * data, size_t size)
+{
+	SHA1_Update(&m_Context, data, size);
+}
+
+std::string SHA1Context::finish()
 {
 	const char * hex = "0123456789abcdef";
 	char buf[40];
-	SHA_CTX ctx;
 
-	SHA1_Init(&ctx);
-	SHA1_Update(&ctx, data.data(), data.length());
-	SHA1_Final(reinterpret_cast<unsigned char *>(buf), &ctx);
+	SHA1_Final(reinterpret_cast<unsigned char *>(buf), &m_Context);
 
 	for (int i = 19; i >= 0; i--)
 	{
@@ -41,3 +47,10 @@ std::string sha1(const std::string & data)
 
 	return std::string(buf, 40);
 }
+
+std::string sha1(const std::string & data)
+{
+	SHA1Context ctx;
+	ctx.update(data.data(), data.length());
+	return ctx.finish();
+}
@@ -23,8 +23,25 @@
 #ifndef __2a7bc89af2e1be6ac85cc75d9354e771__
 #define __2a7bc89af2e1be6ac85cc75d9354e771__
 
+#include "hasher.h"
+#include "../3rdparty/openssl/include/openssl/sha.h"
 #include <string>
 
+class SHA1Context : public Hasher
+{
+public:
+	SHA1Context();
+
+	void update(const void * data, size_t size) override;
+	std::string finish() override;
+
+private:
+	SHA_CTX m_Context;
+
+	SHA1Context(const SHA1Context &) = delete;
+	SHA1Context & operator=(const SHA1Context &) = delete;
+};
+
 std::string sha1(const std::string & data);
 
 #endif
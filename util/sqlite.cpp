@@ -25,6 +25,9 @@
 #include <stdexcept>
 #include <iostream>
 
+// Time to wait for other processes to release the database before failing with SQLITE_BUSY
+#define BUSY_TIMEOUT_MS 60000
+
 /* SQLiteDatabase */
 
 SQLiteDatabase::SQLiteDatabase(const std::string & name)
@@ -32,6 +35,8 @@ SQLiteDatabase::SQLiteDatabase(const std::string & name)
 	  m_StmtRollback(nullptr),
 	  m_StmtCommit(nullptr),
 	  m_DBFile(name),
+	  m_CacheHits(0),
+	  m_CacheMisses(0),
 	  m_InTransaction(0),
 	  m_TransactionFailed(false)
 {
@@ -41,10 +46,29 @@ SQLiteDatabase::SQLiteDatabase(const std::string & name)
 		throw std::runtime_error(fmt()
 			<< "unable to open sqlite database '" << name << "': " << sqlite3_errstr(err));
 	}
+
+	// Multiple yip processes could work with the same database concurrently. Busy handler retries locked
+	// operations with backoff, and in WAL mode readers do not block the writer.
+	sqlite3_busy_timeout(m_Handle, BUSY_TIMEOUT_MS);
+	try
+	{
+		queryString("PRAGMA journal_mode = WAL");
+		exec("PRAGMA synchronous = NORMAL");
+	}
+	catch (...)
+	{
+		for (const auto & it : m_Statements)
+			sqlite3_finalize(it.second);
+		sqlite3_close_v2(m_Handle);
+		throw;
+	}
 }
 
 SQLiteDatabase::~SQLiteDatabase()
 {
+	for (const auto & it : m_Statements)
+		sqlite3_finalize(it.second);
+
 	if (m_StmtBegin)
 		sqlite3_finalize(m_StmtBegin);
 	if (m_StmtRollback)
@@ -63,8 +87,7 @@ SQLiteDatabase::~SQLiteDatabase()
 
 void SQLiteDatabase::exec(const char * sql, const std::initializer_list<std::string> & params)
 {
-	sqlite3_stmt * stmt = nullptr;
-	prepare(stmt, sql);
+	sqlite3_stmt * stmt = acquireStatement(sql);
 
 	try
 	{
@@ -73,18 +96,17 @@ void SQLiteDatabase::exec(const char * sql, const std::initializer_list<std::str
 	}
 	catch (...)
 	{
-		sqlite3_finalize(stmt);
+		releaseStatement(stmt);
 		throw;
 	}
 
-	sqlite3_finalize(stmt);
+	releaseStatement(stmt);
 }
 
 void SQLiteDatabase::select(const char * sql, const std::initializer_list<std::string> & params,
 	SQLiteCallback onRow)
 {
-	sqlite3_stmt * stmt = nullptr;
-	prepare(stmt, sql);
+	sqlite3_stmt * stmt = acquireStatement(sql);
 
 	try
 	{
@@ -94,11 +116,11 @@ void SQLiteDatabase::select(const char * sql, const std::initializer_list<std::s
 	}
 	catch (...)
 	{
-		sqlite3_finalize(stmt);
+		releaseStatement(stmt);
 		throw;
 	}
 
-	sqlite3_finalize(stmt);
+	releaseStatement(stmt);
 }
 
 int SQLiteDatabase::queryInt(const char * sql)
@@ -177,6 +199,44 @@ void SQLiteDatabase::prepare(sqlite3_stmt *& stmt, const char * sql)
 	}
 }
 
+sqlite3_stmt * SQLiteDatabase::acquireStatement(const char * sql)
+{
+	auto it = m_Statements.find(sql);
+	if (it != m_Statements.end())
+	{
+		// Statement could already be running if it is issued again from the row callback
+		if (!sqlite3_stmt_busy(it->second))
+		{
+			++m_CacheHits;
+			return it->second;
+		}
+
+		++m_CacheMisses;
+		sqlite3_stmt * stmt = nullptr;
+		prepare(stmt, sql);
+		return stmt;
+	}
+
+	++m_CacheMisses;
+	sqlite3_stmt * stmt = nullptr;
+	prepare(stmt, sql);
+	m_Statements.insert(std::make_pair(std::string(sql), stmt));
+	return stmt;
+}
+
+void SQLiteDatabase::releaseStatement(sqlite3_stmt * stmt)
+{
+	auto it = m_Statements.find(sqlite3_sql(stmt));
+	if (it == m_Statements.end() || it->second != stmt)
+	{
+		sqlite3_finalize(stmt);
+		return;
+	}
+
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+}
+
 void SQLiteDatabase::bind(sqlite3_stmt * stmt, const std::initializer_list<std::string> & params)
 {
 	int i = 1;
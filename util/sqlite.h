@@ -25,6 +25,7 @@
 
 #include "../3rdparty/sqlite3/sqlite3.h"
 #include <string>
+#include <unordered_map>
 #include <memory>
 #include <initializer_list>
 #include <ctime>
@@ -64,12 +65,18 @@ public:
 	std::string queryString(const char * sql);
 	inline std::string queryString(const std::string & sql) { return queryString(sql.c_str()); }
 
+	inline size_t statementCacheHits() const { return m_CacheHits; }
+	inline size_t statementCacheMisses() const { return m_CacheMisses; }
+
 private:
 	sqlite3 * m_Handle;
 	sqlite3_stmt * m_StmtBegin;
 	sqlite3_stmt * m_StmtRollback;
 	sqlite3_stmt * m_StmtCommit;
+	std::unordered_map<std::string, sqlite3_stmt *> m_Statements;	// Prepared statements keyed by SQL text
 	std::string m_DBFile;
+	size_t m_CacheHits;
+	size_t m_CacheMisses;
 	int m_InTransaction;
 	bool m_TransactionFailed;
 
@@ -78,6 +85,8 @@ private:
 	void commit();
 
 	void prepare(sqlite3_stmt *& stmt, const char * sql);
+	sqlite3_stmt * acquireStatement(const char * sql);
+	void releaseStatement(sqlite3_stmt * stmt);
 	void bind(sqlite3_stmt * stmt, const std::initializer_list<std::string> & params);
 	void exec(sqlite3_stmt * stmt, std::function<void()> = nullptr);
 
@@ -0,0 +1,139 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "stat_cache.h"
+#include "path-util/path-util.h"
+#include "cxx-util/cxx-util/fmt.h"
+#include <unordered_map>
+#include <mutex>
+#include <stdexcept>
+
+namespace
+{
+	struct Entry
+	{
+		bool hasStat = false;
+		bool exists = false;
+		FileStat stat;
+		bool hasCanonical = false;
+		std::string canonical;
+		unsigned generation = 0;		// Incremented by every invalidation of the entry
+	};
+
+	std::mutex g_Mutex;
+	std::unordered_map<std::string, Entry> g_Entries;
+}
+
+// File system is queried without holding the lock. Concurrent queries for the same path store the same result.
+// The result is not stored if the entry has been invalidated during the query, as it could be stale.
+
+bool cachedFileStat(const std::string & path, FileStat & st)
+{
+	std::unique_lock<std::mutex> lock(g_Mutex);
+	Entry & entry = g_Entries[path];
+	if (entry.hasStat)
+	{
+		st = entry.stat;
+		return entry.exists;
+	}
+	unsigned generation = entry.generation;
+	lock.unlock();
+
+	FileStat newStat;
+	bool exists = fileStat(path, newStat);
+
+	lock.lock();
+	Entry & newEntry = g_Entries[path];
+	if (newEntry.generation == generation)
+	{
+		newEntry.hasStat = true;
+		newEntry.exists = exists;
+		newEntry.stat = newStat;
+	}
+
+	st = newStat;
+	return exists;
+}
+
+bool cachedPathIsExistent(const std::string & path)
+{
+	FileStat st;
+	return cachedFileStat(path, st);
+}
+
+time_t cachedPathGetModificationTime(const std::string & path)
+{
+	FileStat st;
+	if (!cachedFileStat(path, st))
+		throw std::runtime_error(fmt() << "unable to stat file '" << path << "'.");
+	return static_cast<time_t>(st.modificationTimeNs / 1000000000LL);
+}
+
+std::string cachedPathMakeCanonical(const std::string & path)
+{
+	std::unique_lock<std::mutex> lock(g_Mutex);
+	Entry & entry = g_Entries[path];
+	if (entry.hasCanonical)
+		return entry.canonical;
+	unsigned generation = entry.generation;
+	lock.unlock();
+
+	std::string canonical = pathMakeCanonical(path);
+
+	lock.lock();
+	Entry & newEntry = g_Entries[path];
+	if (newEntry.generation == generation)
+	{
+		newEntry.hasCanonical = true;
+		newEntry.canonical = canonical;
+	}
+
+	return canonical;
+}
+
+static void invalidateEntry(Entry & entry)
+{
+	entry.hasStat = false;
+	entry.hasCanonical = false;
+	entry.canonical.clear();
+	++entry.generation;
+}
+
+// Entries are reset rather than erased, so that queries running concurrently notice the invalidation
+void statCacheInvalidate(const std::string & path)
+{
+	std::lock_guard<std::mutex> lock(g_Mutex);
+
+	auto it = g_Entries.find(path);
+	if (it == g_Entries.end())
+		return;
+
+	// Canonical form of the path is a separate entry and could be cached as well
+	if (it->second.hasCanonical && it->second.canonical != path)
+	{
+		auto canonical = g_Entries.find(it->second.canonical);
+		if (canonical != g_Entries.end())
+			invalidateEntry(canonical->second);
+	}
+
+	invalidateEntry(it->second);
+}
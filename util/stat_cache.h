@@ -0,0 +1,40 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __5af49a3699fe454187b62cc45ad191a3__
+#define __5af49a3699fe454187b62cc45ad191a3__
+
+#include "file_stat.h"
+#include <string>
+#include <ctime>
+
+// Process-wide cache of file system queries. Results are kept for the duration of the run, so code that modifies
+// a file should call statCacheInvalidate() for it afterwards. All functions are thread-safe.
+
+bool cachedFileStat(const std::string & path, FileStat & st);
+bool cachedPathIsExistent(const std::string & path);
+time_t cachedPathGetModificationTime(const std::string & path);
+std::string cachedPathMakeCanonical(const std::string & path);
+
+void statCacheInvalidate(const std::string & path);
+
+#endif
@@ -0,0 +1,80 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __f88b516d9afd4b348029ce0a6a1ad754__
+#define __f88b516d9afd4b348029ce0a6a1ad754__
+
+#include <string>
+#include <ostream>
+#include <cstring>
+
+// Non-owning reference to a sequence of characters. Referenced memory should outlive the object.
+class StringRef
+{
+public:
+	inline StringRef() : m_Data(""), m_Length(0) {}
+	inline StringRef(const char * data, size_t length) : m_Data(data), m_Length(length) {}
+	inline StringRef(const char * str) : m_Data(str), m_Length(strlen(str)) {}
+	inline StringRef(const std::string & str) : m_Data(str.data()), m_Length(str.length()) {}
+
+	inline const char * data() const { return m_Data; }
+	inline size_t length() const { return m_Length; }
+	inline size_t size() const { return m_Length; }
+	inline bool empty() const { return m_Length == 0; }
+
+	inline const char * begin() const { return m_Data; }
+	inline const char * end() const { return m_Data + m_Length; }
+
+	inline char operator[](size_t index) const { return m_Data[index]; }
+
+	inline std::string str() const { return std::string(m_Data, m_Length); }
+	inline operator std::string() const { return str(); }
+
+	inline int compare(const StringRef & other) const
+	{
+		int result = memcmp(m_Data, other.m_Data, m_Length < other.m_Length ? m_Length : other.m_Length);
+		if (result != 0)
+			return result;
+		return (m_Length < other.m_Length ? -1 : (m_Length > other.m_Length ? 1 : 0));
+	}
+
+	inline bool operator==(const StringRef & other) const
+		{ return m_Length == other.m_Length && memcmp(m_Data, other.m_Data, m_Length) == 0; }
+	inline bool operator!=(const StringRef & other) const { return !(*this == other); }
+
+	inline bool operator==(const char * str) const { return *this == StringRef(str); }
+	inline bool operator!=(const char * str) const { return !(*this == StringRef(str)); }
+
+	inline bool operator==(const std::string & str) const { return *this == StringRef(str); }
+	inline bool operator!=(const std::string & str) const { return !(*this == StringRef(str)); }
+
+private:
+	const char * m_Data;
+	size_t m_Length;
+};
+
+inline std::ostream & operator<<(std::ostream & stream, const StringRef & str)
+{
+	return stream.write(str.data(), static_cast<std::streamsize>(str.length()));
+}
+
+#endif
@@ -0,0 +1,108 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(size_t numThreads)
+	: m_RunningTasks(0),
+	  m_Shutdown(false)
+{
+	if (numThreads == 0)
+		numThreads = std::thread::hardware_concurrency();
+	if (numThreads == 0)
+		numThreads = 1;
+
+	m_Threads.reserve(numThreads);
+	for (size_t i = 0; i < numThreads; i++)
+		m_Threads.push_back(std::thread(&ThreadPool::workerThread, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Tasks.clear();
+		m_Shutdown = true;
+	}
+
+	m_TaskAvailable.notify_all();
+	for (std::thread & thread : m_Threads)
+		thread.join();
+}
+
+void ThreadPool::run(const Task & task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Tasks.push_back(task);
+	}
+
+	m_TaskAvailable.notify_one();
+}
+
+void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	while (m_Tasks.size() > 0 || m_RunningTasks > 0)
+		m_TasksDone.wait(lock);
+
+	if (m_Exception)
+	{
+		std::exception_ptr exception = m_Exception;
+		m_Exception = nullptr;
+		std::rethrow_exception(exception);
+	}
+}
+
+void ThreadPool::workerThread()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	for (;;)
+	{
+		while (m_Tasks.size() == 0 && !m_Shutdown)
+			m_TaskAvailable.wait(lock);
+		if (m_Shutdown)
+			return;
+
+		Task task = std::move(m_Tasks.front());
+		m_Tasks.pop_front();
+		++m_RunningTasks;
+
+		lock.unlock();
+		try
+		{
+			task();
+			lock.lock();
+		}
+		catch (...)
+		{
+			lock.lock();
+			if (!m_Exception)
+				m_Exception = std::current_exception();
+			m_Tasks.clear();
+		}
+		--m_RunningTasks;
+
+		if (m_Tasks.size() == 0 && m_RunningTasks == 0)
+			m_TasksDone.notify_all();
+	}
+}
@@ -0,0 +1,67 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __cd1fa644e6f74225ae2d62dc405d76e3__
+#define __cd1fa644e6f74225ae2d62dc405d76e3__
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	typedef std::function<void()> Task;
+
+	// If 'numThreads' is zero, number of hardware threads is used
+	explicit ThreadPool(size_t numThreads = 0);
+	~ThreadPool();
+
+	inline size_t numThreads() const { return m_Threads.size(); }
+
+	void run(const Task & task);
+
+	// Waits for all queued tasks to complete. If any of the tasks has thrown an exception, remaining tasks are
+	// discarded and the first exception is rethrown.
+	void wait();
+
+private:
+	std::vector<std::thread> m_Threads;
+	std::deque<Task> m_Tasks;
+	std::mutex m_Mutex;
+	std::condition_variable m_TaskAvailable;
+	std::condition_variable m_TasksDone;
+	std::exception_ptr m_Exception;
+	size_t m_RunningTasks;
+	bool m_Shutdown;
+
+	void workerThread();
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool & operator=(const ThreadPool &) = delete;
+};
+
+#endif
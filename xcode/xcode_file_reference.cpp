@@ -36,6 +36,7 @@ const std::string XCODE_FILETYPE_SOURCECODE_CPP_CPP = "sourcecode.cpp.cpp";
 const std::string XCODE_FILETYPE_SOURCECODE_CPP_H = "sourcecode.cpp.h";
 const std::string XCODE_FILETYPE_SOURCECODE_C_OBJC = "sourcecode.c.objc";
 const std::string XCODE_FILETYPE_SOURCECODE_CPP_OBJCPP = "sourcecode.cpp.objcpp";
+const std::string XCODE_FILETYPE_SOURCECODE_ASM = "sourcecode.asm";
 const std::string XCODE_FILETYPE_SOURCECODE_GLSL = "sourcecode.glsl";
 const std::string XCODE_FILETYPE_SOURCECODE_JAVA = "sourcecode.java";
 const std::string XCODE_FILETYPE_IMAGE_PNG = "image.png";
@@ -40,6 +40,7 @@ extern const std::string XCODE_FILETYPE_SOURCECODE_CPP_CPP;
 extern const std::string XCODE_FILETYPE_SOURCECODE_CPP_H;
 extern const std::string XCODE_FILETYPE_SOURCECODE_C_OBJC;
 extern const std::string XCODE_FILETYPE_SOURCECODE_CPP_OBJCPP;
+extern const std::string XCODE_FILETYPE_SOURCECODE_ASM;
 extern const std::string XCODE_FILETYPE_SOURCECODE_GLSL;
 extern const std::string XCODE_FILETYPE_SOURCECODE_JAVA;
 extern const std::string XCODE_FILETYPE_IMAGE_PNG;